@@ -1,7 +1,14 @@
 #include <facter/facterlib.h>
 #include <facter/facts/fact_map.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <facter/facts/external/resolver.hpp>
+#include <facter/facts/external/json_resolver.hpp>
 #include <facter/logging/logging.hpp>
 #include <facter/util/string.hpp>
+#include <facter/util/compression.hpp>
+#include <facter/util/file.hpp>
 #include <log4cxx/logger.h>
 #include <log4cxx/propertyconfigurator.h>
 #include <log4cxx/patternlayout.h>
@@ -123,14 +130,22 @@ int main(int argc, char **argv)
         // Keep this list sorted alphabetically
         po::options_description visible_options("");
         visible_options.add_options()
+            ("compress", po::value<string>(), "Compress the output with the given format (gzip).")
             ("debug,d", "Enable debug output.")
+            ("diff", po::value<string>(), "Output only the facts that differ from the facts in the given JSON file.")
+            ("diff-update", "Update the file given to the diff option with the current facts.")
+            ("digest", "Output a digest of the facts rather than the facts themselves.")
             ("external-dir", po::value<vector<string>>()->multitoken(), "The directory to use for external facts.")
+            ("from-snapshot", po::value<string>(), "Load facts from the given snapshot file rather than resolving them.")
             ("help", "Print this help message.")
             ("json,j", "Output in JSON format.")
+            ("legacy-strings", "Output numeric facts that were historically strings, such as processorcount, as strings.")
             ("no-external-dir", "Turn off external facts")
             ("propfile,p", po::value<string>(&properties_file), "Configure logging with a log4cxx properties file.")
+            ("stream", "Output each fact as a line of JSON as soon as it is resolved.")
             ("verbose", "Enable verbose (info) output.")
             ("version,v", "Print the version and exit.")
+            ("write-snapshot", po::value<string>(), "Write the resolved facts to the given snapshot file.")
             ("yaml,y", "Output in YAML format.");
 
         // Build a list of "hidden" options that are not visible on the command line
@@ -166,6 +181,30 @@ int main(int argc, char **argv)
             if (vm.count("no-external-dir") && vm.count("external-dir")) {
                 throw po::error("no-external-dir and external-dir options conflict. please specify one or the other.");
             }
+            if (vm.count("stream") && (vm.count("json") || vm.count("yaml"))) {
+                throw po::error("stream option conflicts with json and yaml options. please specify only one output format.");
+            }
+            if (vm.count("stream") && vm.count("fact")) {
+                throw po::error("stream option cannot be used when requesting specific facts.");
+            }
+            if (vm.count("stream") && vm.count("digest")) {
+                throw po::error("stream and digest options conflict. please specify one or the other.");
+            }
+            if (vm.count("diff") && (vm.count("stream") || vm.count("digest"))) {
+                throw po::error("diff option conflicts with stream and digest options. please specify only one.");
+            }
+            if (vm.count("diff") && vm.count("fact")) {
+                throw po::error("diff option cannot be used when requesting specific facts.");
+            }
+            if (vm.count("from-snapshot") && (vm.count("stream") || vm.count("external-dir") || vm.count("write-snapshot"))) {
+                throw po::error("from-snapshot option conflicts with stream, external-dir, and write-snapshot options. please specify only one.");
+            }
+            if (vm.count("diff-update") && !vm.count("diff")) {
+                throw po::error("diff-update option requires the diff option.");
+            }
+            if (vm.count("compress") && vm["compress"].as<string>() != "gzip") {
+                throw po::error("unsupported compression format. the only supported format is gzip.");
+            }
         }
         catch(po::error& ex) {
             cerr << "error: " << ex.what() << "\n\n";
@@ -209,28 +248,156 @@ int main(int argc, char **argv)
 
         log_requested_facts(requested_facts);
 
-        // Resolve the facts
+        vector<string> external_directories;
+        if (!vm["external-dir"].empty()) {
+            external_directories = vm["external-dir"].as<vector<string>>();
+        }
+
+        // When compressing, the output is compressed as it is written rather than buffered
+        ostream* output = &cout;
+        unique_ptr<gzip_ostream> compressed;
+        if (vm.count("compress")) {
+            compressed.reset(new gzip_ostream(cout));
+            output = compressed.get();
+        }
+
         fact_map facts;
-        facts.resolve(requested_facts);
+        facts.legacy_strings(vm.count("legacy-strings") != 0);
+
+        // When streaming, write each fact as it is resolved rather than holding all facts until the end
+        if (vm.count("stream")) {
+            facts.stream([&](string const& name, value const* val) {
+                fact_map::write_json_line(*output, name, val);
+                output->flush();
+            }, external_directories, !vm.count("no-external-dir"));
+            if (compressed) {
+                compressed->finish();
+            }
+            return EXIT_SUCCESS;
+        }
+
+        if (vm.count("from-snapshot")) {
+            // Load the facts from the snapshot without resolving anything
+            facts.clear();
+            try {
+                snapshot(vm["from-snapshot"].as<string>()).populate(facts, requested_facts);
+            } catch (snapshot_exception& ex) {
+                LOG_ERROR("facts could not be loaded from snapshot: %1%", ex.what());
+                return EXIT_FAILURE;
+            }
+        } else {
+            // Resolve the facts
+            facts.resolve(requested_facts);
+
+            // Resolve external facts next; this allows external facts to take precedence over built-in facts
+            if (!vm.count("no-external-dir")) {
+                facts.resolve_external(external_directories, requested_facts);
+            }
+        }
+
+        if (vm.count("write-snapshot")) {
+            try {
+                snapshot::write(vm["write-snapshot"].as<string>(), facts);
+            } catch (snapshot_exception& ex) {
+                LOG_ERROR("facts could not be written to snapshot: %1%", ex.what());
+                return EXIT_FAILURE;
+            }
+        }
 
-        // Resolve external facts next; this allows external facts to take precedence over built-in facts
-        if (!vm.count("no-external-dir")) {
-            if (vm["external-dir"].empty()) {
-                facts.resolve_external({}, requested_facts);
+        // When diffing, output only the facts that were added, removed, or changed since the previous facts
+        if (vm.count("diff")) {
+            auto const& previous_path = vm["diff"].as<string>();
+            fact_map previous;
+            previous.clear();
+            bs::error_code ec;
+            if (exists(previous_path, ec)) {
+                try {
+                    external::json_resolver::read(previous_path, previous);
+                } catch (external::external_fact_exception& ex) {
+                    LOG_ERROR("previous facts could not be read from \"%1%\": %2%.", previous_path, ex.what());
+                    return EXIT_FAILURE;
+                }
             } else {
-                facts.resolve_external(vm["external-dir"].as<vector<string>>(), requested_facts);
+                LOG_INFO("previous facts file \"%1%\" does not exist: all facts will be output.", previous_path);
+            }
+
+            if (vm.count("json")) {
+                facts.write_json_diff(*output, previous);
+            } else if (vm.count("yaml")) {
+                facts.write_yaml_diff(*output, previous);
+            } else {
+                bool first = true;
+                facts.diff(previous, [&](string const& name, value const* previous_value, value const* current_value) {
+                    if (first) {
+                        first = false;
+                    } else {
+                        *output << '\n';
+                    }
+                    if (!previous_value) {
+                        *output << "+ " << name << " => " << *current_value;
+                    } else if (!current_value) {
+                        *output << "- " << name << " => " << *previous_value;
+                    } else {
+                        *output << "~ " << name << " => " << *current_value;
+                    }
+                    return true;
+                });
+            }
+            *output << '\n';
+            if (compressed) {
+                compressed->finish();
+            }
+
+            if (vm.count("diff-update")) {
+                if (!file::atomic_write(previous_path, [&](ostream& stream) { facts.write_json_compact(stream); stream << '\n'; })) {
+                    LOG_ERROR("facts could not be written to \"%1%\".", previous_path);
+                    return EXIT_FAILURE;
+                }
             }
+            return EXIT_SUCCESS;
+        }
+
+        // When outputting a digest, JSON and YAML output include the digest of each fact
+        if (vm.count("digest")) {
+            auto fact_set_digest = facts.digest();
+            if (vm.count("json") || vm.count("yaml")) {
+                auto fact_digests = make_value<map_value>();
+                facts.each_digest([&](string const& name, sha256_digest const& digest) {
+                    fact_digests->add(string(name), make_value<string_value>(to_hex(digest.data(), digest.size())));
+                    return true;
+                });
+
+                fact_map digests;
+                digests.clear();
+                digests.add("digest", make_value<string_value>(to_hex(fact_set_digest.data(), fact_set_digest.size())));
+                digests.add("facts", move(fact_digests));
+                if (vm.count("json")) {
+                    digests.write_json(*output);
+                } else {
+                    digests.write_yaml(*output);
+                }
+            } else {
+                *output << to_hex(fact_set_digest.data(), fact_set_digest.size());
+            }
+            *output << '\n';
+            if (compressed) {
+                compressed->finish();
+            }
+            return EXIT_SUCCESS;
         }
 
         // Output the facts
         if (vm.count("json")) {
-            facts.write_json(cout);
+            facts.write_json(*output);
         } else if (vm.count("yaml")) {
-            facts.write_yaml(cout);
+            facts.write_yaml(*output);
         } else {
-            cout << facts;
+            *output << facts;
+        }
+        *output << '\n';
+        if (compressed) {
+            compressed->finish();
         }
-        cout << '\n';
     } catch (exception& ex) {
         LOG_FATAL("Unhandled exception: %1%", ex.what());
         return EXIT_FAILURE;
@@ -1,4 +1,5 @@
 require 'ffi'
+require 'json'
 
 module CFacter
 
@@ -22,6 +23,8 @@ module CFacter
     callback :array_end_callback,     [],                   :void
     callback :map_start_callback,     [:string],            :void
     callback :map_end_callback,       [],                   :void
+    callback :digest_callback,        [:string, :string],   :void
+    callback :load_callback,          [:bool, :pointer],    :void
 
     class EnumerationCallbacks < FFI::Struct
       layout :string,       :string_callback,
@@ -36,10 +39,25 @@ module CFacter
 
     attach_function :get_facter_version,    [],                     :string
     attach_function :load_facts,            [:string],              :void
+    attach_function :load_facts_async,      [:string, :load_callback, :pointer], :bool
+    attach_function :wait_facts,            [],                     :void
+    attach_function :cancel_load_facts,     [],                     :void
+    attach_function :refresh_facts,         [:string],              :void
+    attach_function :load_snapshot,         [:string, :string],     :bool
+    attach_function :write_snapshot,        [:string],              :bool
     attach_function :clear_facts,           [],                     :void
     attach_function :search_external,       [:string],              :void
+    attach_function :reset_external,        [],                     :void
+    attach_function :set_legacy_strings,    [:bool],                :void
+    attach_function :start_spawn_helper,    [],                     :bool
+    attach_function :set_process_limit,     [:uint],                :void
     attach_function :enumerate_facts,       [:pointer],             :void
     attach_function :get_fact_value,        [:string, :pointer],    :bool
+    attach_function :get_fact_values,       [:pointer, :size_t, :pointer], :size_t
+    attach_function :get_facts_json,        [:string],              :pointer
+    attach_function :free_facts_buffer,     [:pointer],             :void
+    attach_function :get_facts_digest,      [],                     :pointer
+    attach_function :enumerate_fact_digests, [:digest_callback],   :void
   end
 
   # The facter gem version.
@@ -64,6 +82,62 @@ module CFacter
     FacterLib.load_facts nil
   end
 
+  # Starts loading all facts in the background.
+  # The previously loaded facts remain available until loading finishes.
+  #
+  # @yield [loaded] Called from a background thread when loading finishes.
+  # @yieldparam loaded [Boolean] true if the facts were loaded or false if loading failed; the previously loaded facts remain if loading failed.
+  # @return [Boolean] true if loading started or false if facts are already being loaded.
+  # @api public
+  def self.loadfacts_async(&block)
+    # Keep a reference to the callback so it is not collected while the library holds it
+    @load_callback = block ? proc { |loaded, _| block.call(loaded) } : nil
+    FacterLib.load_facts_async(nil, @load_callback, nil)
+  end
+
+  # Waits for facts being loaded in the background.
+  #
+  # @return [void]
+  # @api public
+  def self.wait
+    FacterLib.wait_facts
+  end
+
+  # Cancels loading facts in the background; the loaded facts are discarded.
+  #
+  # @return [void]
+  # @api public
+  def self.cancel
+    FacterLib.cancel_load_facts
+  end
+
+  # Refreshes the given facts without reloading all other facts.
+  #
+  # @param names [Array<String>] The names of the facts to refresh.
+  # @return [void]
+  # @api public
+  def self.refresh(names)
+    FacterLib.refresh_facts(names.join(','))
+  end
+
+  # Loads facts from a snapshot file rather than resolving them.
+  #
+  # @param path [String] The path to the snapshot file.
+  # @return [Boolean] true if the snapshot was loaded or false if it could not be read.
+  # @api public
+  def self.load_snapshot(path)
+    FacterLib.load_snapshot(path, nil)
+  end
+
+  # Atomically writes the loaded facts to a snapshot file.
+  #
+  # @param path [String] The path to the snapshot file.
+  # @return [Boolean] true if the snapshot was written or false if it could not be written.
+  # @api public
+  def self.write_snapshot(path)
+    FacterLib.write_snapshot(path)
+  end
+
   # Clears all cached values and removes all facts from memory.
   #
   # @return [void]
@@ -81,6 +155,45 @@ module CFacter
     FacterLib.search_external(dirs.join(':'))
   end
 
+  # Stops searching all previously registered directories for external facts.
+  #
+  # @return [void]
+  # @api public
+  def self.reset_external
+    FacterLib.reset_external
+  end
+
+  # Sets whether numeric facts that older versions of facter resolved as
+  # strings (such as processorcount) are resolved as strings.
+  #
+  # @param enabled [Boolean] true to resolve the facts as strings
+  # @return [void]
+  # @api public
+  def self.legacy_strings=(enabled)
+    FacterLib.set_legacy_strings(enabled)
+  end
+
+  # Starts a helper process that spawns the programs run to resolve facts,
+  # so the Ruby process is not duplicated for each program.
+  # Call this early, before the process grows or starts other threads.
+  #
+  # @return [Boolean] true if the helper is running
+  # @api public
+  def self.start_spawn_helper
+    FacterLib.start_spawn_helper
+  end
+
+  # Sets the maximum number of programs run to resolve facts that may run at
+  # once; other programs wait in the order they were started.  Defaults to
+  # the number of processors.
+  #
+  # @param limit [Integer] the maximum number of programs, or 0 for no limit
+  # @return [void]
+  # @api public
+  def self.process_limit=(limit)
+    FacterLib.set_process_limit(limit)
+  end
+
   # Creates callbacks used when enumerating facts from cfacter.
   # Each callback simply appends the corresponding Ruby type to the hash/array
   # being built up during the enumeration.  This allows us to effectively copy
@@ -145,9 +258,15 @@ module CFacter
   # @return [Hash{String => Object}] the hash of fact names and values
   # @api public
   def self.to_hash
-    result = {}
-    FacterLib.enumerate_facts(self.create_enumeration_callbacks(result))
-    result
+    # Get all facts as a single JSON buffer rather than enumerating them
+    # to avoid crossing the FFI boundary for every value.
+    buffer = FacterLib.get_facts_json(nil)
+    return {} if buffer.null?
+    begin
+      JSON.parse(buffer.read_string)
+    ensure
+      FacterLib.free_facts_buffer(buffer)
+    end
   end
 
   # Gets the value for a fact. Returns `nil` if no such fact exists.
@@ -162,4 +281,45 @@ module CFacter
     return nil unless FacterLib.get_fact_value(name, self.create_enumeration_callbacks(result))
     result[0]
   end
+
+  # Gets the values of multiple facts in a single call. Facts that do not
+  # exist are not included in the result.
+  #
+  # @param names [Array<String>] The fact names.
+  # @return [Hash{String => Object}] the hash of fact names and values
+  # @api public
+  def self.values(names)
+    strings = names.map { |name| FFI::MemoryPointer.from_string(name.to_s) }
+    array = FFI::MemoryPointer.new(:pointer, strings.size)
+    array.write_array_of_pointer(strings)
+    result = {}
+    FacterLib.get_fact_values(array, strings.size, self.create_enumeration_callbacks(result))
+    result
+  end
+
+  # Gets the digest of all loaded facts. The digest only changes when a fact
+  # is added, removed, or changed.
+  #
+  # @return [String, nil] The SHA-256 digest as a hexadecimal string, or nil if facts are not loaded.
+  # @api public
+  def self.digest
+    buffer = FacterLib.get_facts_digest
+    return nil if buffer.null?
+    begin
+      buffer.read_string
+    ensure
+      FacterLib.free_facts_buffer(buffer)
+    end
+  end
+
+  # Gets a hash mapping fact names to the digests of their values.
+  # Comparing the digests with previous digests finds the facts that have changed.
+  #
+  # @return [Hash{String => String}] the hash of fact names and SHA-256 digests
+  # @api public
+  def self.fact_digests
+    result = {}
+    FacterLib.enumerate_fact_digests(Proc.new { |name, digest| result[name] = digest })
+    result
+  end
 end
@@ -31,13 +31,25 @@ shared_context "enumeration" do
   }
 
   def enumerate(facts)
-    CFacter::FacterLib.stubs(:enumerate_facts).with do |*args|
-      facts.each do |k, v|
-        enumeration_helper.call k, v, *args
-      end
+    CFacter::FacterLib.stubs(:get_fact_value).with do |name, callbacks|
+      enumeration_helper.call name, facts[name], callbacks
+      true
+    end.returns(true)
+    facts.each do |k, v|
+      CFacter.value(k).should eq v
     end
+    CFacter::FacterLib.unstub :get_fact_value
+  end
+end
+
+shared_context "decoding" do
+
+  def decode(facts)
+    buffer = FFI::MemoryPointer.from_string(JSON.generate(facts))
+    CFacter::FacterLib.stubs(:get_facts_json).with(nil).returns(buffer)
+    CFacter::FacterLib.expects(:free_facts_buffer).with(buffer)
     CFacter.to_hash.should eq facts
-    CFacter::FacterLib.unstub :enumerate_facts
+    CFacter::FacterLib.unstub :get_facts_json
   end
 end
 
@@ -130,6 +142,28 @@ describe CFacter do
     end
   end
 
+  describe "should decode" do
+    include_context "decoding"
+
+    it "scalar facts" do
+      decode({
+        'fact1' => 'value1',
+        'fact2' => 2,
+        'fact3' => true,
+        'fact4' => 123.456,
+        'fact5' => Float::MAX
+      })
+    end
+
+    it "array and hash facts" do
+      decode({
+        'fact1' => [ 'one', 2, [ 'three' ] ],
+        'fact2' => { 'hash' => { 'foo' => 'bar', 'array' => [ 1.5 ] } },
+        'fact3' => []
+      })
+    end
+  end
+
   it "should load external facts" do
     CFacter.search_external([
       File.expand_path('../../../lib/tests/fixtures/facts/external/yaml', File.dirname(__FILE__)),
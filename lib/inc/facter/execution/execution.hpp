@@ -9,7 +9,10 @@
 #include <vector>
 #include <map>
 #include <stdexcept>
+#include <exception>
 #include <functional>
+#include <mutex>
+#include <cstdint>
 #include "../util/option_set.hpp"
 
 namespace facter { namespace execution {
@@ -44,6 +47,16 @@ namespace facter { namespace execution {
          * Merge specified environment with the current process environment.
          */
         merge_environment = (1 << 5),
+        /**
+         * Reuse the output of an earlier execution of the same program with the same arguments, environment, and options.
+         * Output is cached in the current execution_cache until it is cleared; failures and output passed to a line callback are not cached.
+         */
+        cache_output = (1 << 6),
+        /**
+         * Capture stderr separately from stdout and log it at debug level.
+         * Ignored if redirect_stderr is specified.
+         */
+        capture_stderr = (1 << 7),
         /**
          * A combination of all throw options.
          */
@@ -111,6 +124,19 @@ namespace facter { namespace execution {
         int _status_code;
     };
 
+    /**
+     * Exception that is thrown when a child does not complete within its timeout.
+     * The child's process group is killed before the exception is thrown.
+     */
+    struct timeout_exception : execution_exception
+    {
+        /**
+         * Constructs a timeout_exception.
+         * @param message The exception message.
+         */
+        explicit timeout_exception(std::string const& message);
+    };
+
     /**
      * Exception that is thrown when a child exists due to a signal.
      */
@@ -134,27 +160,177 @@ namespace facter { namespace execution {
         int _signal;
     };
 
+    /**
+     * Caches the executables found by which and the output of programs executed with the cache_output option.
+     * Searching and executing use the cache made current on the calling thread by an execution_cache::scope.
+     * If no cache is current, a cache shared by the process is used.
+     */
+    struct execution_cache
+    {
+        /**
+         * Makes a cache current on the calling thread for the lifetime of the scope.
+         * The previously current cache is restored when the scope is destroyed.
+         */
+        struct scope
+        {
+            /**
+             * Constructs a scope that makes the given cache current.
+             * @param cache The cache to make current; it must outlive the scope.
+             */
+            explicit scope(execution_cache& cache);
+
+            /**
+             * Restores the previously current cache.
+             */
+            ~scope();
+
+            /**
+             * Prevents the scope from being copied.
+             */
+            scope(scope const&) = delete;
+
+            /**
+             * Prevents the scope from being copied.
+             * @returns Returns this scope.
+             */
+            scope& operator=(scope const&) = delete;
+
+         private:
+            execution_cache* _previous;
+        };
+
+        /**
+         * Constructs an empty cache.
+         */
+        execution_cache();
+
+        /**
+         * Gets the cache that is current on the calling thread.
+         * @return Returns the current cache.
+         */
+        static execution_cache& current();
+
+        /**
+         * Finds a cached result of searching for an executable.
+         * @param path The PATH that was searched.
+         * @param file The name of the executable.
+         * @param result Set to the path of the executable or empty if it was not found.
+         * @return Returns true if a result is cached for the given PATH or false if not.
+         */
+        bool find_executable(std::string const& path, std::string const& file, std::string& result);
+
+        /**
+         * Caches the result of searching for an executable; results for a different PATH are discarded.
+         * @param path The PATH that was searched.
+         * @param file The name of the executable.
+         * @param result The path of the executable or empty if it was not found.
+         */
+        void store_executable(std::string const& path, std::string const& file, std::string const& result);
+
+        /**
+         * Clears the cached executables.
+         */
+        void clear_executables();
+
+        /**
+         * Finds cached output.
+         * @param key The key identifying the program, arguments, environment, and options.
+         * @param output Set to the cached output.
+         * @return Returns true if output is cached for the key or false if not.
+         */
+        bool find_output(std::string const& key, std::string& output);
+
+        /**
+         * Caches output.
+         * @param key The key identifying the program, arguments, environment, and options.
+         * @param output The output to cache.
+         */
+        void store_output(std::string const& key, std::string const& output);
+
+        /**
+         * Clears the cached output.
+         */
+        void clear_output();
+
+     private:
+        execution_cache(execution_cache const&) = delete;
+        execution_cache& operator=(execution_cache const&) = delete;
+
+        std::mutex _lock;
+        std::string _search_path;
+        std::map<std::string, std::string> _executables;
+        std::map<std::string, std::string> _output;
+    };
+
+    /**
+     * Searches for an executable.
+     * Names are searched for in the PATH directories; paths are checked as given.
+     * Results are cached in the current execution_cache, including executables that were not found, until the cache is cleared or PATH changes.
+     * @param file The name or path of the executable.
+     * @return Returns the path to the executable or empty string if it was not found.
+     */
+    std::string which(std::string const& file);
+
+    /**
+     * Clears the executables searched for with which from the current execution_cache.
+     */
+    void clear_which_cache();
+
+    /**
+     * Clears the output cached in the current execution_cache by executing programs with the cache_output option.
+     */
+    void clear_output_cache();
+
+    /**
+     * Starts a helper process that spawns child processes on behalf of this process.
+     * The helper is forked without exec and makes only async-signal-safe calls, so it may be started from a multithreaded process.
+     * The helper keeps a copy of this process's memory, so it should be started early, while this process is small.
+     * Child processes are spawned directly if the helper is not started or stops running.
+     * @return Returns true if the helper is running or false if it could not be started.
+     */
+    bool start_spawn_helper();
+
+    /**
+     * Sets the maximum number of child processes that may run at once across all threads.
+     * Programs started while the limit is reached wait for a running child process to exit, in the order they were started.
+     * Programs that are not found do not wait.
+     * A thread that is already running a child process, such as from a line callback, may start another without waiting.
+     * The limit defaults to the number of processors.
+     * @param limit The maximum number of child processes, or 0 for no limit.
+     */
+    void set_process_limit(unsigned int limit);
+
+    /**
+     * Gets the maximum number of child processes that may run at once across all threads.
+     * @return Returns the maximum number of child processes, or 0 if there is no limit.
+     */
+    unsigned int get_process_limit();
+
     /**
      * Executes the given program.
      * @param file The name or path of the program to execute.
      * @param options The execution options.
+     * @param timeout The number of seconds to wait for the program to complete, or 0 to wait indefinitely.
      * @return Returns the child process output.
      */
     std::string execute(
         std::string const& file,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program.
      * @param file The name or path of the program to execute.
      * @param arguments The arguments to pass to the program.
      * @param options The execution options.
+     * @param timeout The number of seconds to wait for the program to complete, or 0 to wait indefinitely.
      * @return Returns the child process output.
      */
     std::string execute(
         std::string const& file,
         std::vector<std::string> const& arguments,
-        facter::util::option_set<execution_options> const& options  = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program.
@@ -162,24 +338,28 @@ namespace facter { namespace execution {
      * @param arguments The arguments to pass to the program.
      * @param environment The environment variables to pass to the child process.
      * @param options The execution options.
+     * @param timeout The number of seconds to wait for the program to complete, or 0 to wait indefinitely.
      * @return Returns the child process output.
      */
     std::string execute(
         std::string const& file,
         std::vector<std::string> const& arguments,
         std::map<std::string, std::string> const& environment,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program and returns each line of output.
      * @param file The name or path of the program to execute.
      * @param callback The callback that is called with each line of output.
      * @param options The execution options.
+     * @param timeout The number of seconds to wait for the program to complete, or 0 to wait indefinitely.
      */
     void each_line(
         std::string const& file,
         std::function<bool(std::string&)> callback,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program and returns each line of output.
@@ -187,12 +367,14 @@ namespace facter { namespace execution {
      * @param arguments The arguments to pass to the program.
      * @param callback The callback that is called with each line of output.
      * @param options The execution options.
+     * @param timeout The number of seconds to wait for the program to complete, or 0 to wait indefinitely.
      */
     void each_line(
         std::string const& file,
         std::vector<std::string> const& arguments,
         std::function<bool(std::string&)> callback,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
 
     /**
      * Executes the given program and returns each line of output.
@@ -201,13 +383,72 @@ namespace facter { namespace execution {
      * @param environment The environment variables to pass to the child process.
      * @param callback The callback that is called with each line of output.
      * @param options The execution options.
+     * @param timeout The number of seconds to wait for the program to complete, or 0 to wait indefinitely.
      */
     void each_line(
         std::string const& file,
         std::vector<std::string> const& arguments,
         std::map<std::string, std::string> const& environment,
         std::function<bool(std::string&)> callback,
-        facter::util::option_set<execution_options> const& options = { execution_options::defaults });
+        facter::util::option_set<execution_options> const& options = { execution_options::defaults },
+        uint32_t timeout = 0);
+
+    /**
+     * Represents a command to execute as part of a batch.
+     */
+    struct command
+    {
+        /**
+         * Constructs a command.
+         * @param file The name or path of the program to execute.
+         * @param arguments The arguments to pass to the program.
+         * @param options The execution options.
+         * @param timeout The number of seconds to wait for the program to complete, or 0 to wait indefinitely.
+         */
+        command(
+            std::string file,
+            std::vector<std::string> arguments = {},
+            facter::util::option_set<execution_options> options = { execution_options::defaults },
+            uint32_t timeout = 0);
+
+        /**
+         * The name or path of the program to execute.
+         */
+        std::string file;
+        /**
+         * The arguments to pass to the program.
+         */
+        std::vector<std::string> arguments;
+        /**
+         * The environment variables to pass to the child process.
+         */
+        std::map<std::string, std::string> environment;
+        /**
+         * The execution options.
+         */
+        facter::util::option_set<execution_options> options;
+        /**
+         * The optional callback that is called with each line of output.
+         * If set, the command's output is passed to the callback rather than returned.
+         */
+        std::function<bool(std::string&)> callback;
+        /**
+         * The number of seconds to wait for the program to complete, or 0 to wait indefinitely.
+         */
+        uint32_t timeout;
+    };
+
+    /**
+     * Executes the given programs concurrently.
+     * As many programs are started as the process limit allows; the rest are started as running programs exit.
+     * Within the limit, the total time is that of the slowest program.
+     * Every child process is waited on before the first failure (in command order) is thrown.
+     * Each command's timeout is enforced separately.
+     * @param commands The commands to execute.
+     * @param failures If not null, receives the failure of each command (or null on success), in command order, instead of the first failure being thrown.
+     * @return Returns the output of each child process, in command order.
+     */
+    std::vector<std::string> execute_many(std::vector<command> const& commands, std::vector<std::exception_ptr>* failures = nullptr);
 
 }}  // namespace facter::execution
 
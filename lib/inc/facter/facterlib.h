@@ -28,6 +28,51 @@ extern "C" {
     ///
     void load_facts(char const* names);
 
+    ///
+    /// Loads and resolves facts on a background thread owned by the library.
+    /// The previously loaded facts remain available until the new facts are ready.
+    /// @param names The comma-delimited list of fact names to resolve.  If null, all facts are resolved.
+    /// @param callback The function to call on the background thread when the load finishes.  May be null.
+    ///                 It is passed true if the facts were loaded or false if loading failed, in which case the previously loaded facts remain.
+    /// @param userdata The pointer to pass to the callback.
+    /// @return Returns true if loading started or false if a load is already in progress.
+    ///
+    bool load_facts_async(char const* names, void(*callback)(bool loaded, void* userdata), void* userdata);
+
+    ///
+    /// Waits for an asynchronous load started with load_facts_async to finish.
+    /// Returns immediately if no load is in progress.
+    ///
+    void wait_facts();
+
+    ///
+    /// Cancels an asynchronous load started with load_facts_async.
+    /// Resolution that is already running is not interrupted, but its results are discarded and the callback is not called.
+    ///
+    void cancel_load_facts();
+
+    ///
+    /// Refreshes the given facts by re-running only the resolvers responsible for them.
+    /// Other loaded facts are left unchanged.  Does nothing if facts are not loaded.
+    /// @param names The comma-delimited list of fact names to refresh.
+    ///
+    void refresh_facts(char const* names);
+
+    ///
+    /// Loads facts from a snapshot file rather than resolving them.
+    /// @param path The path to the snapshot file.
+    /// @param names The comma-delimited list of fact names to load.  If null, all facts in the snapshot are loaded.
+    /// @return Returns true if the snapshot was loaded or false if the snapshot could not be read.
+    ///
+    bool load_snapshot(char const* path, char const* names);
+
+    ///
+    /// Atomically writes the loaded facts to a snapshot file.
+    /// @param path The path to the snapshot file.
+    /// @return Returns true if the snapshot was written or false if facts are not loaded or the snapshot could not be written.
+    ///
+    bool write_snapshot(char const* path);
+
     ///
     /// Clears the facts.
     ///
@@ -96,12 +141,239 @@ extern "C" {
     ///
     bool get_fact_value(char const* name, enumeration_callbacks* callbacks);
 
+    ///
+    /// Gets the values of multiple facts in one call.
+    /// Facts that are not yet resolved are resolved together, running their resolvers concurrently.
+    /// Each fact that exists is enumerated in the order given; facts that do not exist are skipped.
+    /// @param names The array of fact names to get the values of.
+    /// @param count The number of fact names in the array.
+    /// @param callbacks The callback functions to use.
+    /// @return Returns the number of facts that exist.
+    ///
+    size_t get_fact_values(char const* const* names, size_t count, enumeration_callbacks* callbacks);
+
+    ///
+    /// Gets the loaded facts as a single JSON object.
+    /// This is much faster than enumerating facts when all or many facts are needed, since no callbacks are made.
+    /// Doubles are written with enough precision to be read back exactly.
+    /// @param names The comma-delimited list of fact names to get.  If null, all loaded facts are returned.
+    /// @return Returns a null-terminated buffer containing the JSON or null if facts have not been loaded.  The buffer must be freed with free_facts_buffer.
+    ///
+    char* get_facts_json(char const* names);
+
+    ///
+    /// Frees a buffer returned by get_facts_json, get_facts_digest, or the equivalent functions taking a context.
+    /// @param buffer The buffer to free.  May be null.
+    ///
+    void free_facts_buffer(char* buffer);
+
+    ///
+    /// Gets the digest of all loaded facts.
+    /// The digest only changes when a fact is added, removed, or changed, so it can be used to detect changes to the facts.
+    /// @return Returns a null-terminated buffer containing the SHA-256 digest as a hexadecimal string or null if facts have not been loaded.  The buffer must be freed with free_facts_buffer.
+    ///
+    char* get_facts_digest();
+
+    ///
+    /// Enumerates the digest of each loaded fact.
+    /// Comparing these digests with previous digests finds the facts that have changed.
+    /// @param callback The callback function called with each fact name and its SHA-256 digest as a hexadecimal string.
+    ///
+    void enumerate_fact_digests(void(*callback)(char const* name, char const* digest));
+
     ///
     /// Searches the given directories for external facts.
     /// @param directories The directories to search for external facts.
     ///
     void search_external(char const* directories);
 
+    ///
+    /// Stops searching all previously given directories for external facts.
+    ///
+    void reset_external();
+
+    ///
+    /// Sets whether numeric facts that were historically resolved as strings are resolved as strings.
+    /// This applies to processorcount, physicalprocessorcount, mtu_<interface>, selinux_policyversion, lsbmajdistrelease, and lsbminordistrelease.
+    /// Takes effect for facts resolved after the call; facts are resolved as integers by default.
+    /// @param enabled True to resolve the facts as strings or false to resolve them as integers.
+    ///
+    void set_legacy_strings(bool enabled);
+
+    ///
+    /// Starts a helper process that spawns the programs run to resolve facts.
+    /// The helper is forked from the calling process and keeps a copy of its memory, so call this early, while the process is small.
+    /// Spawning through the helper avoids duplicating the state of a large, multithreaded host process for each program.
+    /// Programs are spawned directly if the helper is not started or stops running.
+    /// @return Returns true if the helper is running or false if it could not be started.
+    ///
+    bool start_spawn_helper();
+
+    ///
+    /// Sets the maximum number of programs run to resolve facts that may run at once across all contexts.
+    /// Programs started while the limit is reached wait, in the order they were started, for a running program to exit.
+    /// The limit defaults to the number of processors.
+    /// @param limit The maximum number of programs, or 0 for no limit.
+    ///
+    void set_process_limit(unsigned int limit);
+
+    ///
+    /// Represents an independent set of facts.
+    /// The functions above operate on a default context shared by the process.
+    /// Separate contexts can be used concurrently from different threads.
+    /// Calls on the same context are serialized; callbacks must not call functions on the context that is calling them.
+    ///
+    typedef struct facter_context facter_context;
+
+    ///
+    /// Creates a new context.
+    /// @return Returns the new context, which must be freed with facter_free.
+    ///
+    facter_context* facter_create();
+
+    ///
+    /// Frees a context and all of its facts.
+    /// @param context The context to free.  May be null.
+    ///
+    void facter_free(facter_context* context);
+
+    ///
+    /// Loads and resolves all facts in the given context.
+    /// @param context The context to load facts into.
+    /// @param names The comma-delimited list of fact names to resolve.  If null, all facts are resolved.
+    ///
+    void facter_load_facts(facter_context* context, char const* names);
+
+    ///
+    /// Loads and resolves facts in the given context on a background thread owned by the library.
+    /// The previously loaded facts remain available until the new facts are ready.
+    /// Freeing the context waits for the load to finish, so the context must not be freed from the callback.
+    /// @param context The context to load facts into.
+    /// @param names The comma-delimited list of fact names to resolve.  If null, all facts are resolved.
+    /// @param callback The function to call on the background thread when the load finishes.  May be null.
+    ///                 It is passed true if the facts were loaded or false if loading failed, in which case the previously loaded facts remain.
+    /// @param userdata The pointer to pass to the callback.
+    /// @return Returns true if loading started or false if a load is already in progress.
+    ///
+    bool facter_load_facts_async(facter_context* context, char const* names, void(*callback)(bool loaded, void* userdata), void* userdata);
+
+    ///
+    /// Waits for an asynchronous load of the given context to finish.
+    /// Returns immediately if no load is in progress.
+    /// @param context The context to wait for.
+    ///
+    void facter_wait_facts(facter_context* context);
+
+    ///
+    /// Cancels an asynchronous load of the given context.
+    /// Resolution that is already running is not interrupted, but its results are discarded and the callback is not called.
+    /// @param context The context to cancel loading for.
+    ///
+    void facter_cancel_load_facts(facter_context* context);
+
+    ///
+    /// Refreshes the given facts in the given context by re-running only the resolvers responsible for them.
+    /// Other loaded facts are left unchanged.  Does nothing if facts are not loaded.
+    /// @param context The context to refresh facts in.
+    /// @param names The comma-delimited list of fact names to refresh.
+    ///
+    void facter_refresh_facts(facter_context* context, char const* names);
+
+    ///
+    /// Loads facts from a snapshot file into the given context rather than resolving them.
+    /// @param context The context to load facts into.
+    /// @param path The path to the snapshot file.
+    /// @param names The comma-delimited list of fact names to load.  If null, all facts in the snapshot are loaded.
+    /// @return Returns true if the snapshot was loaded or false if the snapshot could not be read.
+    ///
+    bool facter_load_snapshot(facter_context* context, char const* path, char const* names);
+
+    ///
+    /// Atomically writes the facts in the given context to a snapshot file.
+    /// @param context The context to write facts from.
+    /// @param path The path to the snapshot file.
+    /// @return Returns true if the snapshot was written or false if facts are not loaded or the snapshot could not be written.
+    ///
+    bool facter_write_snapshot(facter_context* context, char const* path);
+
+    ///
+    /// Clears the facts in the given context.
+    /// @param context The context to clear.
+    ///
+    void facter_clear_facts(facter_context* context);
+
+    ///
+    /// Enumerates all facts in the given context.
+    /// @param context The context to enumerate facts from.
+    /// @param callbacks The callback functions to use.
+    ///
+    void facter_enumerate_facts(facter_context* context, enumeration_callbacks* callbacks);
+
+    ///
+    /// Gets the value of a single fact in the given context.
+    /// @param context The context to get the fact from.
+    /// @param name The fact name to get the value of.
+    /// @param callbacks The callback functions to use.
+    /// @return Returns true if the fact exists or false if the fact does not.
+    ///
+    bool facter_get_fact_value(facter_context* context, char const* name, enumeration_callbacks* callbacks);
+
+    ///
+    /// Gets the values of multiple facts in the given context in one call.
+    /// Facts that are not yet resolved are resolved together, running their resolvers concurrently.
+    /// Each fact that exists is enumerated in the order given; facts that do not exist are skipped.
+    /// @param context The context to get the facts from.
+    /// @param names The array of fact names to get the values of.
+    /// @param count The number of fact names in the array.
+    /// @param callbacks The callback functions to use.
+    /// @return Returns the number of facts that exist.
+    ///
+    size_t facter_get_fact_values(facter_context* context, char const* const* names, size_t count, enumeration_callbacks* callbacks);
+
+    ///
+    /// Gets the facts in the given context as a single JSON object.
+    /// @param context The context to get facts from.
+    /// @param names The comma-delimited list of fact names to get.  If null, all loaded facts are returned.
+    /// @return Returns a null-terminated buffer containing the JSON or null if facts have not been loaded.  The buffer must be freed with free_facts_buffer.
+    ///
+    char* facter_get_facts_json(facter_context* context, char const* names);
+
+    ///
+    /// Gets the digest of all facts in the given context.
+    /// @param context The context to get the digest of.
+    /// @return Returns a null-terminated buffer containing the SHA-256 digest as a hexadecimal string or null if facts have not been loaded.  The buffer must be freed with free_facts_buffer.
+    ///
+    char* facter_get_facts_digest(facter_context* context);
+
+    ///
+    /// Enumerates the digest of each fact in the given context.
+    /// @param context The context to enumerate digests from.
+    /// @param callback The callback function called with each fact name and its SHA-256 digest as a hexadecimal string.
+    ///
+    void facter_enumerate_fact_digests(facter_context* context, void(*callback)(char const* name, char const* digest));
+
+    ///
+    /// Searches the given directories for external facts when loading facts into the given context.
+    /// @param context The context to search external facts for.
+    /// @param directories The directories to search for external facts.
+    ///
+    void facter_search_external(facter_context* context, char const* directories);
+
+    ///
+    /// Stops searching all previously given directories for external facts in the given context.
+    /// @param context The context to reset.
+    ///
+    void facter_reset_external(facter_context* context);
+
+    ///
+    /// Sets whether numeric facts that were historically resolved as strings are resolved as strings in the given context.
+    /// This applies to processorcount, physicalprocessorcount, mtu_<interface>, selinux_policyversion, lsbmajdistrelease, and lsbminordistrelease.
+    /// Takes effect for facts resolved after the call; facts are resolved as integers by default.
+    /// @param context The context to change.
+    /// @param enabled True to resolve the facts as strings or false to resolve them as integers.
+    ///
+    void facter_set_legacy_strings(facter_context* context, bool enabled);
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
@@ -6,6 +6,7 @@
 #define FACTER_FACTS_ARRAY_VALUE_HPP_
 
 #include "value.hpp"
+#include "iterator.hpp"
 #include <vector>
 #include <memory>
 #include <functional>
@@ -18,6 +19,12 @@ namespace facter { namespace facts {
      */
     struct array_value : value
     {
+        /**
+         * The const iterator type for the array.
+         * Dereferencing the iterator results in the element value.
+         */
+        typedef value_iterator<std::vector<std::unique_ptr<value>>::const_iterator> const_iterator;
+
         /**
          * Constructs an array_value.
          */
@@ -68,6 +75,40 @@ namespace facter { namespace facts {
          */
         void each(std::function<bool(value const*)> func) const;
 
+        /**
+         * Enumerates all facts in the array.
+         * Unlike the overload taking a std::function, the callback can be inlined.
+         * @tparam Function The type of callback, called with each value; returning false stops the enumeration.
+         * @param func The callback function called for each value in the array.
+         */
+        template <typename Function>
+        void each(Function&& func) const
+        {
+            for (auto element : *this) {
+                if (!func(element)) {
+                    break;
+                }
+            }
+        }
+
+        /**
+         * Gets an iterator to the first value in the array.
+         * @return Returns the iterator to the first value.
+         */
+        const_iterator begin() const
+        {
+            return const_iterator(_elements.begin());
+        }
+
+        /**
+         * Gets an iterator past the last value in the array.
+         * @return Returns the iterator past the last value.
+         */
+        const_iterator end() const
+        {
+            return const_iterator(_elements.end());
+        }
+
         /**
          * Converts the value to a JSON value.
          * @param allocator The allocator to use for creating the JSON value.
@@ -82,6 +123,24 @@ namespace facter { namespace facts {
          */
         virtual void notify(std::string const& name, enumeration_callbacks const* callbacks) const;
 
+        /**
+         * Computes the digest of the value.
+         * @return Returns the SHA-256 digest of the value.
+         */
+        virtual util::sha256_digest digest() const;
+
+        /**
+         * Gets the kind of the value.
+         * @return Returns the kind of the value.
+         */
+        virtual value_kind kind() const;
+
+        /**
+         * Calls the visitor's visit function for the type of the value.
+         * @param visitor The visitor to call.
+         */
+        virtual void accept(value_visitor& visitor) const;
+
         /**
          * Gets the element at the given index.
          * @tparam T The expected type of the value.
@@ -90,7 +149,7 @@ namespace facter { namespace facts {
          */
         template <typename T> T const* get(size_t i) const
         {
-            return dynamic_cast<T const*>(_elements.at(i).get());
+            return value_cast<T>(_elements.at(i).get());
         }
 
         /**
@@ -119,6 +178,12 @@ namespace facter { namespace facts {
         std::vector<std::unique_ptr<value>> _elements;
     };
 
+    /**
+     * The kind of an array value.
+     */
+    template <>
+    struct value_kind_of<array_value> : std::integral_constant<value_kind, value_kind::array> {};
+
 }}  // namespace facter::facts
 
 #endif  // FACTER_FACTS_ARRAY_VALUE_HPP_
@@ -6,6 +6,9 @@
 #define FACTER_FACTS_EXTERNAL_EXECUTION_RESOLVER_HPP_
 
 #include "resolver.hpp"
+#include <cstdint>
+#include <exception>
+#include <map>
 
 namespace facter { namespace facts { namespace external {
 
@@ -14,6 +17,31 @@ namespace facter { namespace facts { namespace external {
      */
     struct execution_resolver : resolver
     {
+        /**
+         * The default number of seconds to wait for an executable to complete.
+         */
+        static const uint32_t default_timeout = 60;
+
+        /**
+         * Constructs an execution_resolver.
+         * @param timeout The number of seconds to wait for an executable to complete, or 0 to wait indefinitely.
+         */
+        explicit execution_resolver(uint32_t timeout = default_timeout);
+
+        /**
+         * Determines if the resolver resolves facts from the given file.
+         * Any file is supported; files that are not executable are reported when resolved.
+         * @param path The path to the file.
+         * @return Always returns true.
+         */
+        virtual bool can_resolve(std::string const& path) const;
+
+        /**
+         * Executes the given files concurrently so that resolve does not need to wait for each one in turn.
+         * @param paths The paths to the files to execute.
+         */
+        virtual void prepare(std::vector<std::string> const& paths);
+
         /**
          * Resolves facts from the given file.
          * @param path The path to the file to resolve facts from.
@@ -21,6 +49,16 @@ namespace facter { namespace facts { namespace external {
          * @return Returns true if the facts were resolved or false if the given file is not supported.
          */
         virtual bool resolve(std::string const& path, fact_map& facts) const;
+
+     private:
+        struct result
+        {
+            std::vector<std::string> lines;
+            std::exception_ptr failure;
+        };
+
+        uint32_t _timeout;
+        std::map<std::string, result> _results;
     };
 
 }}}  // namespace facter::facts::external
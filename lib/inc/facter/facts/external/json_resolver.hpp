@@ -14,6 +14,13 @@ namespace facter { namespace facts { namespace external {
      */
     struct json_resolver : resolver
     {
+        /**
+         * Determines if the resolver resolves facts from the given file.
+         * @param path The path to the file.
+         * @return Returns true if the file is a JSON file or false if it is not supported.
+         */
+        virtual bool can_resolve(std::string const& path) const;
+
         /**
          * Resolves facts from the given file.
          * @param path The path to the file to resolve facts from.
@@ -21,6 +28,13 @@ namespace facter { namespace facts { namespace external {
          * @return Returns true if the facts were resolved or false if the given file is not supported.
          */
         virtual bool resolve(std::string const& path, fact_map& facts) const;
+
+        /**
+         * Reads facts from the given JSON file regardless of the file's extension.
+         * @param path The path to the JSON file to read facts from.
+         * @param facts The fact map to populate the facts into.
+         */
+        static void read(std::string const& path, fact_map& facts);
     };
 
 }}}  // namespace facter::facts::external
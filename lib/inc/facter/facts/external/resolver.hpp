@@ -7,6 +7,7 @@
 
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace facter { namespace facts {
     struct fact_map;
@@ -31,6 +32,25 @@ namespace facter { namespace facts { namespace external {
      */
     struct resolver
     {
+        /**
+         * Destructs the resolver.
+         */
+        virtual ~resolver();
+
+        /**
+         * Determines if the resolver resolves facts from the given file.
+         * @param path The path to the file.
+         * @return Returns true if the resolver resolves facts from the file or false if it is not supported.
+         */
+        virtual bool can_resolve(std::string const& path) const = 0;
+
+        /**
+         * Called with the files this resolver will resolve before resolve is called for each of them.
+         * Resolvers that can do the work for several files at once start it here; the default does nothing.
+         * @param paths The paths to the files, in the order they will be resolved.
+         */
+        virtual void prepare(std::vector<std::string> const& paths);
+
         /**
          * Resolves facts from the given file.
          * @param path The path to the file to resolve facts from.
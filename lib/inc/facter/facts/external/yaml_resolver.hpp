@@ -14,6 +14,13 @@ namespace facter { namespace facts { namespace external {
      */
     struct yaml_resolver : resolver
     {
+        /**
+         * Determines if the resolver resolves facts from the given file.
+         * @param path The path to the file.
+         * @return Returns true if the file is a YAML file or false if it is not supported.
+         */
+        virtual bool can_resolve(std::string const& path) const;
+
         /**
          * Resolves facts from the given file.
          * @param path The path to the file to resolve facts from.
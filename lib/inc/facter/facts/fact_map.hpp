@@ -5,6 +5,9 @@
 #ifndef FACTER_FACTS_FACT_MAP_HPP_
 #define FACTER_FACTS_FACT_MAP_HPP_
 
+#include "value.hpp"
+#include "iterator.hpp"
+#include "../util/sha256.hpp"
 #include <list>
 #include <map>
 #include <set>
@@ -15,10 +18,16 @@
 #include <stdexcept>
 #include <iostream>
 
+namespace facter { namespace execution {
+
+    // Forward declare the execution cache type
+    struct execution_cache;
+
+}}  // namespace facter::execution
+
 namespace facter { namespace facts {
 
-    // Forward declare the value and resolver types
-    struct value;
+    // Forward declare the resolver type
     struct fact_resolver;
 
     /**
@@ -39,6 +48,12 @@ namespace facter { namespace facts {
      */
     struct fact_map
     {
+        /**
+         * The const iterator type for the fact map.
+         * Dereferencing the iterator results in a pair of the fact name and value.
+         */
+        typedef named_value_iterator<std::map<std::string, std::unique_ptr<value>>::const_iterator> const_iterator;
+
         /**
          * Constructs a fact_map.
          */
@@ -80,6 +95,20 @@ namespace facter { namespace facts {
          */
         void clear();
 
+        /**
+         * Sets whether numeric facts that were historically resolved as strings are stored as strings.
+         * This applies to processorcount, physicalprocessorcount, mtu_<interface>, selinux_policyversion, lsbmajdistrelease, and lsbminordistrelease.
+         * Only facts added after the setting is changed are affected; external facts are never affected.
+         * @param enabled True to store the facts as strings or false to store them as integers.
+         */
+        void legacy_strings(bool enabled);
+
+        /**
+         * Gets whether numeric facts that were historically resolved as strings are stored as strings.
+         * @return Returns true if the facts are stored as strings or false if they are stored as integers.
+         */
+        bool legacy_strings() const;
+
         /**
          * Checks to see if the fact map is empty.
          * @return Returns true if the fact map is empty or false if it is not.
@@ -112,6 +141,35 @@ namespace facter { namespace facts {
         */
         void resolve_external(std::vector<std::string> const& directories = {}, std::set<std::string> const& facts = std::set<std::string>());
 
+        /**
+         * Refreshes the given facts by running the resolvers responsible for them again.
+         * Every fact of those resolvers is replaced with its new value or removed if it no longer resolves; all other facts are left unchanged.
+         * Facts the resolvers depend on are taken from this map unless they are also being refreshed.
+         * Facts resolved from external facts are never refreshed, so they continue to take precedence over built-in facts.
+         * @param facts The set of fact names to refresh.
+         */
+        void refresh(std::set<std::string> const& facts);
+
+        /**
+         * Resolves the given facts, running the resolvers responsible for them concurrently.
+         * Each built-in resolver runs on its own thread into a separate fact map; the facts it resolves are then added to this map.
+         * Every resolver runs at most once: a resolver needed by several others runs on the first thread that needs it and the others wait for it.
+         * Facts that are already resolved are not resolved again.
+         * @param facts The set of fact names to resolve.
+         */
+        void resolve_concurrently(std::set<std::string> const& facts);
+
+        /**
+         * Resolves all facts and passes each fact to the given callback as soon as its value is final.
+         * External facts are resolved first so that they continue to take precedence over built-in facts.
+         * Facts that a resolver declares or matches by pattern are retained until all resolvers have run, since other resolvers may request them.
+         * Other facts are released once written, and the map is empty once streaming completes.
+         * @param func The callback function called for each resolved fact.
+         * @param directories The directories to search for external facts.
+         * @param external True if external facts should be resolved or false if only built-in facts should be resolved.
+         */
+        void stream(std::function<void(std::string const&, value const*)> func, std::vector<std::string> const& directories = {}, bool external = true);
+
         /**
          * Gets a fact value by name.
          * @tparam T The expected type of the value.
@@ -122,7 +180,7 @@ namespace facter { namespace facts {
         template <typename T>
         T const* get(std::string const& name, bool resolve = true)
         {
-            return dynamic_cast<T const*>(get_value(name, resolve));
+            return value_cast<T>(get_value(name, resolve));
         }
 
         /**
@@ -132,36 +190,142 @@ namespace facter { namespace facts {
          */
         value const* operator[](std::string const& name);
 
+        /**
+         * Gets an iterator to the first fact in the map.
+         * Only resolved facts are iterated; iterating does not resolve facts.
+         * @return Returns the iterator to the first fact.
+         */
+        const_iterator begin() const
+        {
+            return const_iterator(_facts.begin());
+        }
+
+        /**
+         * Gets an iterator past the last fact in the map.
+         * @return Returns the iterator past the last fact.
+         */
+        const_iterator end() const
+        {
+            return const_iterator(_facts.end());
+        }
+
         /**
          * Enumerates all facts in the map.
          * @param func The callback function called for each fact in the map.
          */
         void each(std::function<bool(std::string const&, value const*)> func) const;
 
+        /**
+         * Enumerates all facts in the map.
+         * Unlike the overload taking a std::function, the callback can be inlined.
+         * @tparam Function The type of callback, called with the name and value of each fact; returning false stops the enumeration.
+         * @param func The callback function called for each fact in the map.
+         */
+        template <typename Function>
+        void each(Function&& func) const
+        {
+            for (auto const& kvp : *this) {
+                if (!func(kvp.first, kvp.second)) {
+                    break;
+                }
+            }
+        }
+
+        /**
+         * Computes the digest of the fact map.
+         * The digest is computed from the digest of each fact in the same way as a map_value's digest.
+         * The digest does not depend on the order in which facts were resolved.
+         * @return Returns the SHA-256 digest of the fact map.
+         */
+        util::sha256_digest digest() const;
+
+        /**
+         * Enumerates the digest of each fact in the map.
+         * Comparing these digests with previously computed digests finds the facts that have changed.
+         * @param func The callback function called for each fact in the map.
+         */
+        void each_digest(std::function<bool(std::string const&, util::sha256_digest const&)> func) const;
+
+        /**
+         * Enumerates the facts that differ from a previous fact map.
+         * Facts are compared structurally, so maps and arrays are only different if any of their elements differ.
+         * @param previous The previous fact map to compare with.
+         * @param func The callback function called for each fact that was added, removed, or changed.  The previous value is null for added facts and the current value is null for removed facts.
+         */
+        void diff(fact_map const& previous, std::function<bool(std::string const&, value const*, value const*)> func) const;
+
+        /**
+         * Writes the differences from a previous fact map as a JSON merge patch to the given stream.
+         * Added and changed facts are written with their current values and removed facts are written as null.
+         * @param stream The stream to write the JSON to.
+         * @param previous The previous fact map to compare with.
+         */
+        void write_json_diff(std::ostream& stream, fact_map const& previous) const;
+
+        /**
+         * Writes the differences from a previous fact map as YAML to the given stream.
+         * Added and changed facts are written with their current values and removed facts are written as null.
+         * @param stream The stream to write the YAML to.
+         * @param previous The previous fact map to compare with.
+         */
+        void write_yaml_diff(std::ostream& stream, fact_map const& previous) const;
+
         /**
          * Writes the contents of the fact map as JSON to the given stream.
          * @param stream The stream to write the JSON to.
          */
         void write_json(std::ostream& stream) const;
 
+        /**
+         * Writes facts as compact JSON to the given stream.
+         * Unlike write_json, doubles are written with enough precision to be read back exactly.
+         * @param stream The stream to write the JSON to.
+         * @param names The set of fact names to write.  If empty, all facts are written.
+         */
+        void write_json_compact(std::ostream& stream, std::set<std::string> const& names = std::set<std::string>()) const;
+
         /**
          * Writes the contents of the fact map as YAML to the given stream.
          * @param stream The stream to write the YAML to.
          */
         void write_yaml(std::ostream& stream) const;
 
+        /**
+         * Writes a single fact as a line of JSON to the given stream.
+         * The line is a JSON object containing only the given fact, suitable for newline-delimited JSON output.
+         * @param stream The stream to write the JSON to.
+         * @param name The name of the fact.
+         * @param val The value of the fact.
+         */
+        static void write_json_line(std::ostream& stream, std::string const& name, value const* val);
+
      private:
         typedef std::map<std::string, std::unique_ptr<value>> fact_map_type;
         typedef std::map<std::string, std::shared_ptr<fact_resolver>> resolver_map_type;
 
         friend std::ostream& operator<<(std::ostream& os, fact_map const& facts);
 
+        // Supplies the facts that a map used by resolve_concurrently or refresh does not have
+        struct delegated_resolution;
+        struct concurrent_resolution;
+        struct refresh_resolution;
+        explicit fact_map(delegated_resolution* delegate);
+
         std::shared_ptr<fact_resolver> find_resolver(std::string const& name);
         value const* get_value(std::string const& name, bool resolve);
+        void merge(fact_map& other, std::vector<std::shared_ptr<fact_resolver>> const& resolvers);
 
         fact_map_type _facts;
         std::list<std::shared_ptr<fact_resolver>> _resolvers;
+        std::vector<std::shared_ptr<fact_resolver>> _added_resolvers;
         resolver_map_type _resolver_map;
+        bool _streaming;
+        std::set<std::string> _pending;
+        bool _resolving_external;
+        std::set<std::string> _external;
+        bool _legacy_strings;
+        delegated_resolution* _delegate;
+        std::unique_ptr<execution::execution_cache> _execution_cache;
     };
 
     /**
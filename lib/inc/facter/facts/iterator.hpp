@@ -0,0 +1,80 @@
+/**
+ * @file
+ * Declares the iterators used to enumerate fact values.
+ */
+#ifndef FACTER_FACTS_ITERATOR_HPP_
+#define FACTER_FACTS_ITERATOR_HPP_
+
+#include <string>
+#include <memory>
+#include <utility>
+#include <boost/iterator/transform_iterator.hpp>
+
+namespace facter { namespace facts {
+
+    // Forward declare the value type
+    struct value;
+
+    /**
+     * Gets the value of an element in a container of owned values.
+     */
+    struct element_value
+    {
+        /**
+         * The result of getting the value.
+         */
+        typedef value const* result_type;
+
+        /**
+         * Gets the value of the given element.
+         * @param element The element to get the value of.
+         * @return Returns the value of the element.
+         */
+        result_type operator()(std::unique_ptr<value> const& element) const
+        {
+            return element.get();
+        }
+    };
+
+    /**
+     * Gets the name and value of an element in a container of owned, named values.
+     */
+    struct named_element_value
+    {
+        /**
+         * The result of getting the name and value.
+         */
+        typedef std::pair<std::string const&, value const*> result_type;
+
+        /**
+         * Gets the name and value of the given element.
+         * @tparam Element The type of element.
+         * @param element The element to get the name and value of.
+         * @return Returns the name and value of the element.
+         */
+        template <typename Element>
+        result_type operator()(Element const& element) const
+        {
+            return result_type(element.first, element.second.get());
+        }
+    };
+
+    /**
+     * Iterates the values of a container of owned values.
+     * Dereferencing the iterator results in a pointer to a const value.
+     * @tparam Iterator The underlying container iterator type.
+     */
+    template <typename Iterator>
+    using value_iterator = boost::transform_iterator<element_value, Iterator>;
+
+    /**
+     * Iterates the names and values of a container of owned, named values.
+     * Dereferencing the iterator results in a pair of the name and a pointer to a const value.
+     * @tparam Iterator The underlying container iterator type.
+     */
+    template <typename Iterator>
+    using named_value_iterator = boost::transform_iterator<named_element_value, Iterator>;
+
+}}  // namespace facter::facts
+
+#endif  // FACTER_FACTS_ITERATOR_HPP_
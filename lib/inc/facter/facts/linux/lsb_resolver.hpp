@@ -6,6 +6,7 @@
 #define FACTER_FACTS_LINUX_LSB_RESOLVER_HPP_
 
 #include "../fact_resolver.hpp"
+#include <string>
 
 namespace facter { namespace facts { namespace linux {
 
@@ -29,23 +30,27 @@ namespace facter { namespace facts { namespace linux {
         /**
          * Called to resolve the LSB dist id fact.
          * @param facts The fact map that is resolving facts.
+         * @param value The value reported by lsb_release for the fact.
          */
-        virtual void resolve_dist_id(fact_map& facts);
+        virtual void resolve_dist_id(fact_map& facts, std::string value);
         /**
          * Called to resolve the LSB dist release fact.
          * @param facts The fact map that is resolving facts.
+         * @param value The value reported by lsb_release for the fact.
          */
-        virtual void resolve_dist_release(fact_map& facts);
+        virtual void resolve_dist_release(fact_map& facts, std::string value);
         /**
          * Called to resolve the LSB dist codename fact.
          * @param facts The fact map that is resolving facts.
+         * @param value The value reported by lsb_release for the fact.
          */
-        virtual void resolve_dist_codename(fact_map& facts);
+        virtual void resolve_dist_codename(fact_map& facts, std::string value);
         /**
          * Called to resolve the LSB dist description fact.
          * @param facts The fact map that is resolving facts.
+         * @param value The value reported by lsb_release for the fact.
          */
-        virtual void resolve_dist_description(fact_map& facts);
+        virtual void resolve_dist_description(fact_map& facts, std::string value);
         /**
          * Called to resolve the LSB dist major and minor release fact.
          * @param facts The fact map that is resolving facts.
@@ -54,8 +59,9 @@ namespace facter { namespace facts { namespace linux {
         /**
          * Called to resolve the LSB release fact.
          * @param facts The fact map that is resolving facts.
+         * @param value The value reported by lsb_release for the fact.
          */
-        virtual void resolve_release(fact_map& facts);
+        virtual void resolve_release(fact_map& facts, std::string value);
     };
 
 }}}  // namespace facter::facts::linux
@@ -6,7 +6,9 @@
 #define FACTER_FACTS_MAP_VALUE_HPP_
 
 #include "value.hpp"
-#include <map>
+#include "iterator.hpp"
+#include <vector>
+#include <utility>
 #include <string>
 #include <memory>
 #include <functional>
@@ -15,14 +17,22 @@ namespace facter { namespace facts {
 
     /**
      * Represents a fact value that maps fact names to values.
+     * Elements are stored in a vector that is kept sorted by name as elements are added, so reading the map does not modify it.
+     * Adding elements in name order appends them; adding them out of order inserts them in place.
      * This type can be moved but cannot be copied.
      */
     struct map_value : value
     {
+        /**
+         * The const iterator type for the map.
+         * Dereferencing the iterator results in a pair of the element name and value.
+         */
+        typedef named_value_iterator<std::vector<std::pair<std::string, std::unique_ptr<value>>>::const_iterator> const_iterator;
+
         /**
          * Constructs a map value.
          */
-        map_value() = default;
+        map_value();
 
         /**
          * Prevents the map_value from being copied.
@@ -47,11 +57,18 @@ namespace facter { namespace facts {
 
         /**
          * Adds a value to the map.
+         * If the map already has an element with the given name, the existing element is kept.
          * @param name The name of map element.
          * @param value The value of the map element.
          */
         void add(std::string&& name, std::unique_ptr<value>&& value);
 
+        /**
+         * Reserves space for the given number of elements.
+         * @param size The number of elements to reserve space for.
+         */
+        void reserve(size_t size);
+
         /**
          * Checks to see if the map is empty.
          * @return Returns true if the map is empty or false if it is not.
@@ -70,6 +87,40 @@ namespace facter { namespace facts {
          */
         void each(std::function<bool(std::string const&, value const*)> func) const;
 
+        /**
+         * Enumerates all facts in the map.
+         * Unlike the overload taking a std::function, the callback can be inlined.
+         * @tparam Function The type of callback, called with the name and value of each element; returning false stops the enumeration.
+         * @param func The callback function called for each element in the map.
+         */
+        template <typename Function>
+        void each(Function&& func) const
+        {
+            for (auto const& kvp : *this) {
+                if (!func(kvp.first, kvp.second)) {
+                    break;
+                }
+            }
+        }
+
+        /**
+         * Gets an iterator to the first element in the map.
+         * @return Returns the iterator to the first element.
+         */
+        const_iterator begin() const
+        {
+            return const_iterator(_elements.begin());
+        }
+
+        /**
+         * Gets an iterator past the last element in the map.
+         * @return Returns the iterator past the last element.
+         */
+        const_iterator end() const
+        {
+            return const_iterator(_elements.end());
+        }
+
         /**
          * Converts the value to a JSON value.
          * @param allocator The allocator to use for creating the JSON value.
@@ -84,6 +135,24 @@ namespace facter { namespace facts {
          */
         virtual void notify(std::string const& name, enumeration_callbacks const* callbacks) const;
 
+        /**
+         * Computes the digest of the value.
+         * @return Returns the SHA-256 digest of the value.
+         */
+        virtual util::sha256_digest digest() const;
+
+        /**
+         * Gets the kind of the value.
+         * @return Returns the kind of the value.
+         */
+        virtual value_kind kind() const;
+
+        /**
+         * Calls the visitor's visit function for the type of the value.
+         * @param visitor The visitor to call.
+         */
+        virtual void accept(value_visitor& visitor) const;
+
         /**
          * Gets the value in the map of the given name.
          * @tparam T The expected type of the value.
@@ -92,7 +161,7 @@ namespace facter { namespace facts {
          */
         template <typename T> T const* get(std::string const& name) const
         {
-            return dynamic_cast<T const*>(this->operator [](name));
+            return value_cast<T>(this->operator [](name));
         }
 
         /**
@@ -118,9 +187,15 @@ namespace facter { namespace facts {
         virtual YAML::Emitter& write(YAML::Emitter& emitter) const;
 
      private:
-        std::map<std::string, std::unique_ptr<value>> _elements;
+        std::vector<std::pair<std::string, std::unique_ptr<value>>> _elements;
     };
 
+    /**
+     * The kind of a map value.
+     */
+    template <>
+    struct value_kind_of<map_value> : std::integral_constant<value_kind, value_kind::map> {};
+
 }}  // namespace facter::facts
 
 #endif  // FACTER_FACTS_MAP_VALUE_HPP_
@@ -57,11 +57,12 @@ namespace facter { namespace facts { namespace osx {
         virtual std::map<std::string, std::string> find_dhcp_servers();
 
         /**
-         * Finds the DHCP server for the given interface.
-         * @param interface The interface to find the DHCP server for.
-         * @returns Returns the DHCP server for the interface or empty string if one isn't found.
+         * Queries the DHCP servers for the given interfaces.
+         * This is used for interfaces without a known DHCP server.
+         * @param interfaces The interfaces to query the DHCP servers for.
+         * @returns Returns a map between interface name and DHCP server for the interfaces with a DHCP server.
          */
-        virtual std::string find_dhcp_server(std::string const& interface);
+        virtual std::map<std::string, std::string> query_dhcp_servers(std::vector<std::string> const& interfaces);
     };
 
 }}}  // namespace facter::facts::osx
@@ -8,6 +8,7 @@
 #include "value.hpp"
 #include <cstdint>
 #include <string>
+#include <memory>
 #include <iostream>
 
 namespace facter { namespace facts {
@@ -73,6 +74,30 @@ namespace facter { namespace facts {
          */
         virtual void notify(std::string const& name, enumeration_callbacks const* callbacks) const;
 
+        /**
+         * Computes the digest of the value.
+         * @return Returns the SHA-256 digest of the value.
+         */
+        virtual util::sha256_digest digest() const;
+
+        /**
+         * Gets the kind of the value.
+         * @return Returns the kind of the value.
+         */
+        virtual value_kind kind() const
+        {
+            return value_kind_of<scalar_value<T>>::value;
+        }
+
+        /**
+         * Calls the visitor's visit function for the type of the value.
+         * @param visitor The visitor to call.
+         */
+        virtual void accept(value_visitor& visitor) const
+        {
+            visitor.visit(*this);
+        }
+
         /**
          * Gets the underlying scalar value.
          * @return Returns the underlying scalar value.
@@ -106,9 +131,140 @@ namespace facter { namespace facts {
         T _value;
     };
 
-    // Declare the specializations for JSON output
+    /**
+     * Represents a string value.
+     * The string is immutable and reference counted; values constructed from the same shared string share one buffer.
+     * This type can be moved but cannot be copied.
+     */
+    template <>
+    struct scalar_value<std::string> : value
+    {
+        /**
+         * Constructs a scalar_value.
+         * @param value The string value to move into this object.
+         */
+        explicit scalar_value(std::string&& value);
+
+        /**
+         * Constructs a scalar_value.
+         * @param value The string value to copy into this object.
+         */
+        explicit scalar_value(std::string const& value);
+
+        /**
+         * Constructs a scalar_value that shares the given string.
+         * @param value The string to share.  If null, the value is an empty string.
+         */
+        explicit scalar_value(std::shared_ptr<std::string const> value);
+
+        /**
+         * Prevents the scalar_value from being copied.
+         */
+        scalar_value(scalar_value const&) = delete;
+        /**
+         * Prevents the scalar_value from being copied.
+         * @returns Returns this scalar_value.
+         */
+        scalar_value& operator=(scalar_value const&) = delete;
+        /**
+         * Moves the given scalar_value into this scalar_value.
+         * The moved-from scalar_value is left as an empty string.
+         * @param other The scalar_value to move into this scalar_value.
+         */
+        scalar_value(scalar_value&& other);
+        /**
+         * Moves the given scalar_value into this scalar_value.
+         * The moved-from scalar_value is left as an empty string.
+         * @param other The scalar_value to move into this scalar_value.
+         * @return Returns this scalar_value.
+         */
+        scalar_value& operator=(scalar_value&& other);
+
+        /**
+         * Converts the value to a JSON value.
+         * @param allocator The allocator to use for creating the JSON value.
+         * @param value The returned JSON value.
+         */
+        virtual void to_json(rapidjson::Allocator& allocator, rapidjson::Value& value) const;
+
+        /**
+         * Notifies the appropriate callback based on the type of the value.
+         * @param name The fact name to pass to the callback.
+         * @param callbacks The callbacks to use to notify.
+         */
+        virtual void notify(std::string const& name, enumeration_callbacks const* callbacks) const;
+
+        /**
+         * Computes the digest of the value.
+         * @return Returns the SHA-256 digest of the value.
+         */
+        virtual util::sha256_digest digest() const;
+
+        /**
+         * Gets the kind of the value.
+         * @return Returns the kind of the value.
+         */
+        virtual value_kind kind() const;
+
+        /**
+         * Calls the visitor's visit function for the type of the value.
+         * @param visitor The visitor to call.
+         */
+        virtual void accept(value_visitor& visitor) const;
+
+        /**
+         * Gets the underlying string value.
+         * @return Returns the underlying string value.
+         */
+        std::string const& value() const { return *_value; }
+
+        /**
+         * Gets the shared string so that another value can share it.
+         * @return Returns the shared string.
+         */
+        std::shared_ptr<std::string const> const& shared() const { return _value; }
+
+     protected:
+        /**
+          * Writes the value to the given stream.
+          * @param os The stream to write to.
+          * @returns Returns the stream being written to.
+          */
+        virtual std::ostream& write(std::ostream& os) const;
+
+        /**
+          * Writes the value to the given YAML emitter.
+          * @param emitter The YAML emitter to write to.
+          * @returns Returns the given YAML emitter.
+          */
+        virtual YAML::Emitter& write(YAML::Emitter& emitter) const;
+
+     private:
+        std::shared_ptr<std::string const> _value;
+    };
+
+    /**
+     * The kind of a string value.
+     */
     template <>
-    void scalar_value<std::string>::to_json(rapidjson::Allocator& allocator, rapidjson::Value& value) const;
+    struct value_kind_of<scalar_value<std::string>> : std::integral_constant<value_kind, value_kind::string> {};
+    /**
+     * The kind of an integer value.
+     */
+    template <>
+    struct value_kind_of<scalar_value<int64_t>> : std::integral_constant<value_kind, value_kind::integer> {};
+    /**
+     * The kind of a boolean value.
+     */
+    template <>
+    struct value_kind_of<scalar_value<bool>> : std::integral_constant<value_kind, value_kind::boolean> {};
+    /**
+     * The kind of a double value.
+     */
+    template <>
+    struct value_kind_of<scalar_value<double>> : std::integral_constant<value_kind, value_kind::dbl> {};
+
+    // Declare the specializations for JSON output
     template <>
     void scalar_value<int64_t>::to_json(rapidjson::Allocator& allocator, rapidjson::Value& value) const;
     template <>
@@ -118,24 +274,25 @@ namespace facter { namespace facts {
 
     // Declare the specializations for notification
     template <>
-    void scalar_value<std::string>::notify(std::string const& name, enumeration_callbacks const* callbacks) const;
-    template <>
     void scalar_value<int64_t>::notify(std::string const& name, enumeration_callbacks const* callbacks) const;
     template <>
     void scalar_value<bool>::notify(std::string const& name, enumeration_callbacks const* callbacks) const;
     template <>
     void scalar_value<double>::notify(std::string const& name, enumeration_callbacks const* callbacks) const;
 
-    // Declare the specializations for YAML output
+    // Declare the specializations for digests
+    template <>
+    util::sha256_digest scalar_value<int64_t>::digest() const;
+    template <>
+    util::sha256_digest scalar_value<bool>::digest() const;
     template <>
-    YAML::Emitter& scalar_value<std::string>::write(YAML::Emitter& emitter) const;
+    util::sha256_digest scalar_value<double>::digest() const;
 
     // Declare the specializations for string output
     template <>
     std::ostream& scalar_value<bool>::write(std::ostream& os) const;
 
     // Declare the common instantiations as external; defined in scalar_value.cc
-    extern template struct scalar_value<std::string>;
     extern template struct scalar_value<int64_t>;
     extern template struct scalar_value<bool>;
     extern template struct scalar_value<double>;
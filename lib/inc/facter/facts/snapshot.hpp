@@ -0,0 +1,99 @@
+/**
+ * @file
+ * Declares the binary fact snapshot.
+ */
+#ifndef FACTER_FACTS_SNAPSHOT_HPP_
+#define FACTER_FACTS_SNAPSHOT_HPP_
+
+#include <set>
+#include <string>
+#include <memory>
+#include <stdexcept>
+#include <cstdint>
+
+namespace facter { namespace facts {
+
+    // Forward declare the value and fact map types
+    struct value;
+    struct fact_map;
+
+    /**
+     * Thrown when a snapshot cannot be read or written.
+     */
+    struct snapshot_exception : std::runtime_error
+    {
+        /**
+         * Constructs a snapshot_exception.
+         * @param message The exception message.
+         */
+        explicit snapshot_exception(std::string const& message);
+    };
+
+    /**
+     * Represents a read-only snapshot of resolved facts.
+     * A snapshot is a compact binary file that uses offsets rather than pointers, so it can be memory mapped and read in place.
+     * Facts are found with a binary search of the sorted fact index and are only converted to values when requested.
+     * This type cannot be moved or copied.
+     */
+    struct snapshot
+    {
+        /**
+         * Constructs a snapshot by memory mapping the given snapshot file.
+         * @param path The path to the snapshot file.
+         */
+        explicit snapshot(std::string const& path);
+
+        /**
+         * Destructs the snapshot.
+         */
+        ~snapshot();
+
+        /**
+         * Prevents the snapshot from being copied.
+         */
+        snapshot(snapshot const&) = delete;
+        /**
+         * Prevents the snapshot from being copied.
+         * @returns Returns this snapshot.
+         */
+        snapshot& operator=(snapshot const&) = delete;
+
+        /**
+         * Gets the number of facts in the snapshot.
+         * @return Returns the number of top-level facts in the snapshot.
+         */
+        size_t size() const;
+
+        /**
+         * Gets a fact value by name.
+         * @param name The name of the fact to get the value of.
+         * @return Returns the fact value or nullptr if the fact is not in the snapshot.
+         */
+        std::unique_ptr<value> get(std::string const& name) const;
+
+        /**
+         * Adds facts from the snapshot to the given fact map.
+         * @param facts The fact map to add the facts to.
+         * @param names The set of fact names to add.  If empty, all facts in the snapshot are added.
+         */
+        void populate(fact_map& facts, std::set<std::string> const& names = std::set<std::string>()) const;
+
+        /**
+         * Atomically writes the resolved facts in the given fact map to a snapshot file.
+         * Readers of an existing snapshot file see either the old or the new snapshot, never a partial one.
+         * @param path The path to the snapshot file.
+         * @param facts The facts to write to the snapshot.
+         */
+        static void write(std::string const& path, fact_map const& facts);
+
+     private:
+        void validate() const;
+        bool find(std::string const& name, uint64_t& offset) const;
+
+        uint8_t const* _data;
+        size_t _size;
+    };
+
+}}  // namespace facter::facts
+
+#endif  // FACTER_FACTS_SNAPSHOT_HPP_
@@ -5,7 +5,10 @@
 #ifndef FACTER_FACTS_VALUE_HPP_
 #define FACTER_FACTS_VALUE_HPP_
 
+#include "../util/sha256.hpp"
 #include <string>
+#include <cstdint>
+#include <type_traits>
 #include <functional>
 #include <memory>
 #include <iostream>
@@ -36,6 +39,98 @@ extern "C" {
 
 namespace facter { namespace facts {
 
+    // Forward declare the value types
+    template <typename T> struct scalar_value;
+    struct array_value;
+    struct map_value;
+
+    /**
+     * Represents the kind of a value.
+     */
+    enum class value_kind
+    {
+        /**
+         * The value is a string_value.
+         */
+        string,
+        /**
+         * The value is an integer_value.
+         */
+        integer,
+        /**
+         * The value is a boolean_value.
+         */
+        boolean,
+        /**
+         * The value is a double_value.
+         */
+        dbl,
+        /**
+         * The value is an array_value.
+         */
+        array,
+        /**
+         * The value is a map_value.
+         */
+        map
+    };
+
+    /**
+     * Gets the kind of a value type.
+     * Specialized for each value type with a constant member named value.
+     * @tparam T The value type.
+     */
+    template <typename T>
+    struct value_kind_of;
+
+    /**
+     * Visits values based on their type.
+     * Used to branch on the type of a value without casting.
+     */
+    struct value_visitor
+    {
+        /**
+         * Destructs the visitor.
+         */
+        virtual ~value_visitor() = default;
+
+        /**
+         * Visits a string value.
+         * @param val The value being visited.
+         */
+        virtual void visit(scalar_value<std::string> const& val) = 0;
+
+        /**
+         * Visits an integer value.
+         * @param val The value being visited.
+         */
+        virtual void visit(scalar_value<int64_t> const& val) = 0;
+
+        /**
+         * Visits a boolean value.
+         * @param val The value being visited.
+         */
+        virtual void visit(scalar_value<bool> const& val) = 0;
+
+        /**
+         * Visits a double value.
+         * @param val The value being visited.
+         */
+        virtual void visit(scalar_value<double> const& val) = 0;
+
+        /**
+         * Visits an array value.
+         * @param val The value being visited.
+         */
+        virtual void visit(array_value const& val) = 0;
+
+        /**
+         * Visits a map value.
+         * @param val The value being visited.
+         */
+        virtual void visit(map_value const& val) = 0;
+    };
+
     /**
      * Base class for values.
      * This type can be moved but cannot be copied.
@@ -87,6 +182,26 @@ namespace facter { namespace facts {
          */
         virtual void notify(std::string const& name, enumeration_callbacks const* callbacks) const = 0;
 
+        /**
+         * Computes the digest of the value.
+         * The digest is canonical: values with the same type, structure, and contents have the same digest.
+         * Maps and arrays combine the digests of their elements so that changed elements can be found by comparing digests.
+         * @return Returns the SHA-256 digest of the value.
+         */
+        virtual util::sha256_digest digest() const = 0;
+
+        /**
+         * Gets the kind of the value.
+         * @return Returns the kind of the value.
+         */
+        virtual value_kind kind() const = 0;
+
+        /**
+         * Calls the visitor's visit function for the type of the value.
+         * @param visitor The visitor to call.
+         */
+        virtual void accept(value_visitor& visitor) const = 0;
+
      protected:
         /**
           * Writes the value to the given stream.
@@ -118,6 +233,32 @@ namespace facter { namespace facts {
         return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
     }
 
+    /**
+     * Casts a value to the given value type.
+     * Unlike dynamic_cast, this only compares the kind of the value.
+     * @tparam T The value type to cast to.
+     * @param val The value to cast.
+     * @return Returns the value as the given type or nullptr if the value is null or not of the given type.
+     */
+    template <typename T>
+    T const* value_cast(value const* val)
+    {
+        return val && val->kind() == value_kind_of<T>::value ? static_cast<T const*>(val) : nullptr;
+    }
+
+    /**
+     * Casts a value to the given value type.
+     * Unlike dynamic_cast, this only compares the kind of the value.
+     * @tparam T The value type to cast to.
+     * @param val The value to cast.
+     * @return Returns the value as the given type or nullptr if the value is null or not of the given type.
+     */
+    template <typename T>
+    T* value_cast(value* val)
+    {
+        return val && val->kind() == value_kind_of<T>::value ? static_cast<T*>(val) : nullptr;
+    }
+
     /**
      * Insertion operator for value.
      * @param os The output stream to write to.
@@ -0,0 +1,115 @@
+/**
+ * @file
+ * Declares the streams for compressing output.
+ */
+#ifndef FACTER_UTIL_COMPRESSION_HPP_
+#define FACTER_UTIL_COMPRESSION_HPP_
+
+#include <streambuf>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <memory>
+
+// Forward declare the zlib stream so users of this header don't have to include zlib
+struct z_stream_s;
+
+namespace facter { namespace util {
+
+    /**
+     * Thrown when data cannot be compressed.
+     */
+    struct compression_exception : std::runtime_error
+    {
+        /**
+         * Constructs a compression_exception.
+         * @param message The exception message.
+         */
+        explicit compression_exception(std::string const& message);
+    };
+
+    /**
+     * Stream buffer that gzip compresses data as it is written and passes it to an underlying stream.
+     * Only a fixed size buffer is used, so output is never held in memory in its entirety.
+     * This type cannot be moved or copied.
+     */
+    struct gzip_streambuf : std::streambuf
+    {
+        /**
+         * Constructs a gzip_streambuf.
+         * @param stream The underlying stream to write the compressed data to.
+         * @param level The compression level (0-9) or -1 for the default level.
+         */
+        explicit gzip_streambuf(std::ostream& stream, int level = -1);
+
+        /**
+         * Destructs the gzip_streambuf.
+         * The compressed stream is finished if it has not been already.
+         */
+        virtual ~gzip_streambuf();
+
+        /**
+         * Prevents the gzip_streambuf from being copied.
+         */
+        gzip_streambuf(gzip_streambuf const&) = delete;
+        /**
+         * Prevents the gzip_streambuf from being copied.
+         * @returns Returns this gzip_streambuf.
+         */
+        gzip_streambuf& operator=(gzip_streambuf const&) = delete;
+
+        /**
+         * Compresses any remaining data and writes the gzip trailer to the underlying stream.
+         * Nothing can be written to the buffer once it has finished.
+         */
+        void finish();
+
+     protected:
+        /**
+         * Called when the put area is full.
+         * @param ch The character that did not fit into the put area.
+         * @return Returns the character on success or EOF on failure.
+         */
+        virtual int_type overflow(int_type ch);
+
+        /**
+         * Flushes the compressed data written so far to the underlying stream.
+         * @return Returns 0 on success or -1 on failure.
+         */
+        virtual int sync();
+
+     private:
+        bool deflate_input(int flush);
+
+        std::ostream& _stream;
+        std::unique_ptr<z_stream_s> _zstream;
+        std::vector<char> _input;
+        std::vector<char> _output;
+        bool _finished;
+    };
+
+    /**
+     * Output stream that gzip compresses data as it is written to an underlying stream.
+     */
+    struct gzip_ostream : std::ostream
+    {
+        /**
+         * Constructs a gzip_ostream.
+         * @param stream The underlying stream to write the compressed data to.
+         * @param level The compression level (0-9) or -1 for the default level.
+         */
+        explicit gzip_ostream(std::ostream& stream, int level = -1);
+
+        /**
+         * Compresses any remaining data and writes the gzip trailer to the underlying stream.
+         */
+        void finish();
+
+     private:
+        gzip_streambuf _buffer;
+    };
+
+}}  // namespace facter::util
+
+#endif  // FACTER_UTIL_COMPRESSION_HPP_
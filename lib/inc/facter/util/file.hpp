@@ -8,6 +8,7 @@
 #include <string>
 #include <stdexcept>
 #include <functional>
+#include <iostream>
 
 namespace facter { namespace util { namespace file {
 
@@ -49,6 +50,16 @@ namespace facter { namespace util { namespace file {
      */
     bool read_first_line(std::string const& path, std::string& line);
 
+    /**
+     * Atomically replaces the given file.
+     * The contents are written to a temporary file in the same directory which is then renamed over the given file.
+     * Readers of the file therefore see either the old or the new contents, but never partial contents.
+     * @param path The path of the file to write.
+     * @param writer The function called to write the contents to the given stream.
+     * @return Returns true if the file was written or false if the file could not be written.
+     */
+    bool atomic_write(std::string const& path, std::function<void(std::ostream&)> writer);
+
 }}}  // namespace facter::util::file
 
 #endif  // FACTER_UTIL_FILE_HPP_
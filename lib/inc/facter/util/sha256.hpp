@@ -0,0 +1,85 @@
+/**
+ * @file
+ * Declares the SHA-256 hashing utility.
+ */
+#ifndef FACTER_UTIL_SHA256_HPP_
+#define FACTER_UTIL_SHA256_HPP_
+
+#include <array>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace facter { namespace util {
+
+    /**
+     * Represents a SHA-256 digest.
+     */
+    typedef std::array<uint8_t, 32> sha256_digest;
+
+    /**
+     * Incrementally computes a SHA-256 digest.
+     * This type cannot be moved or copied.
+     */
+    struct sha256
+    {
+        /**
+         * Constructs a sha256.
+         */
+        sha256();
+
+        /**
+         * Destructs a sha256.
+         */
+        ~sha256();
+
+        /**
+         * Prevents the sha256 from being copied.
+         */
+        sha256(sha256 const&) = delete;
+        /**
+         * Prevents the sha256 from being copied.
+         * @returns Returns this sha256.
+         */
+        sha256& operator=(sha256 const&) = delete;
+
+        /**
+         * Adds data to the digest.
+         * @param data The data to add.
+         * @param size The size of the data, in bytes.
+         */
+        void update(void const* data, size_t size);
+
+        /**
+         * Adds a string to the digest.
+         * @param str The string to add.
+         */
+        void update(std::string const& str);
+
+        /**
+         * Adds a digest to the digest.
+         * @param digest The digest to add.
+         */
+        void update(sha256_digest const& digest);
+
+        /**
+         * Adds a 64-bit integer to the digest in little-endian byte order.
+         * @param value The integer to add.
+         */
+        void update(uint64_t value);
+
+        /**
+         * Finishes computing the digest.
+         * No more data can be added once the digest is finished.
+         * @return Returns the SHA-256 digest of the data.
+         */
+        sha256_digest finish();
+
+     private:
+        struct context;
+        std::unique_ptr<context> _context;
+    };
+
+}}  // namespace facter::util
+
+#endif  // FACTER_UTIL_SHA256_HPP_
@@ -141,6 +141,16 @@ namespace facter { namespace util {
      */
     std::string to_hex(uint8_t const* bytes, size_t length, bool uppercase = false);
 
+    /**
+     * Converts the given string to an integer.
+     * Only canonical decimal integers are converted, so converting the integer back to a string results in the same string.
+     * Strings such as "04", "+4", or " 4" are not converted.
+     * @param str The string to convert.
+     * @param value The returned integer value.
+     * @return Returns true if the string was converted or false if the string is not a canonical decimal integer.
+     */
+    bool to_integer(std::string const& str, int64_t& value);
+
     /**
      * Reads each line from the given string.
      * @param s The string to read.
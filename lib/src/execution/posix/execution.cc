@@ -5,10 +5,31 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <fcntl.h>
+#include <spawn.h>
+#include <signal.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include <cstring>
 #include <sstream>
+#include <memory>
+#include <exception>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 
 using namespace std;
+using namespace std::chrono;
 using namespace facter::util;
 using namespace facter::util::posix;
 using namespace facter::logging;
@@ -19,6 +40,11 @@ LOG_DECLARE_NAMESPACE("execution.posix");
 // Declare environ for OSX
 extern char** environ;
 
+// OSX does not support MSG_NOSIGNAL; SO_NOSIGPIPE is set on the socket instead
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
 namespace facter { namespace execution {
 
     execution_exception::execution_exception(string const& message) :
@@ -48,6 +74,11 @@ namespace facter { namespace execution {
         return _status_code;
     }
 
+    timeout_exception::timeout_exception(string const& message) :
+        execution_exception(message)
+    {
+    }
+
     child_signal_exception::child_signal_exception(int signal, string const& output, string const& message) :
         execution_failure_exception(output, message),
         _signal(signal)
@@ -76,294 +107,1687 @@ namespace facter { namespace execution {
         LOG_DEBUG("Executing command: %1%", command_line.str());
     }
 
-    static string execute(
-        string const& file,
-        vector<string> const* arguments,
-        map<string, string> const* environment,
-        function<bool(string&)>* callback,
-        option_set<execution_options> const& options);
+    // The cache current on each thread is stored in thread-specific data; threads without one use the process cache
+    static pthread_key_t g_cache_key;
+    static pthread_once_t g_cache_key_once = PTHREAD_ONCE_INIT;
 
-    string execute(
-        string const& file,
-        option_set<execution_options> const& options)
+    static void create_current_cache_key()
     {
-        return execute(file, nullptr, nullptr, nullptr, options);
+        pthread_key_create(&g_cache_key, nullptr);
     }
 
-    string execute(
-        string const& file,
-        vector<string> const& arguments,
-        option_set<execution_options> const& options)
+    execution_cache::scope::scope(execution_cache& cache)
     {
-        return execute(file, &arguments, nullptr, nullptr, options);
+        pthread_once(&g_cache_key_once, create_current_cache_key);
+        _previous = static_cast<execution_cache*>(pthread_getspecific(g_cache_key));
+        pthread_setspecific(g_cache_key, &cache);
     }
 
-    string execute(
-        string const& file,
-        vector<string> const& arguments,
-        map<string, string> const& environment,
-        option_set<execution_options> const& options)
+    execution_cache::scope::~scope()
     {
-        return execute(file, &arguments, &environment, nullptr, options);
+        pthread_setspecific(g_cache_key, _previous);
     }
 
-    void each_line(
-        string const& file,
-        function<bool(string&)> callback,
-        option_set<execution_options> const& options)
+    execution_cache::execution_cache()
     {
-        execute(file, nullptr, nullptr, &callback, options);
     }
 
-    void each_line(
-        string const& file,
-        vector<string> const& arguments,
-        function<bool(string&)> callback,
-        option_set<execution_options> const& options)
+    execution_cache& execution_cache::current()
     {
-        execute(file, &arguments, nullptr, &callback, options);
+        static execution_cache process_cache;
+
+        pthread_once(&g_cache_key_once, create_current_cache_key);
+        auto cache = static_cast<execution_cache*>(pthread_getspecific(g_cache_key));
+        return cache ? *cache : process_cache;
     }
 
-    void each_line(
-        string const& file,
-        vector<string> const& arguments,
-        map<string, string> const& environment,
-        function<bool(string&)> callback,
-        option_set<execution_options> const& options)
+    bool execution_cache::find_executable(string const& path, string const& file, string& result)
     {
-        execute(file, &arguments, &environment, &callback, options);
+        lock_guard<mutex> lock(_lock);
+        if (path != _search_path) {
+            return false;
+        }
+        auto it = _executables.find(file);
+        if (it == _executables.end()) {
+            return false;
+        }
+        result = it->second;
+        return true;
     }
 
-    string execute(
+    void execution_cache::store_executable(string const& path, string const& file, string const& result)
+    {
+        lock_guard<mutex> lock(_lock);
+
+        // Results are only valid for the PATH they were found in
+        if (path != _search_path) {
+            _executables.clear();
+            _search_path = path;
+        }
+        _executables.emplace(file, result);
+    }
+
+    void execution_cache::clear_executables()
+    {
+        lock_guard<mutex> lock(_lock);
+        _executables.clear();
+        _search_path.clear();
+    }
+
+    bool execution_cache::find_output(string const& key, string& output)
+    {
+        lock_guard<mutex> lock(_lock);
+        auto it = _output.find(key);
+        if (it == _output.end()) {
+            return false;
+        }
+        output = it->second;
+        return true;
+    }
+
+    void execution_cache::store_output(string const& key, string const& output)
+    {
+        lock_guard<mutex> lock(_lock);
+        _output.emplace(key, output);
+    }
+
+    void execution_cache::clear_output()
+    {
+        lock_guard<mutex> lock(_lock);
+        _output.clear();
+    }
+
+    static bool is_executable(string const& path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode) && access(path.c_str(), X_OK) == 0;
+    }
+
+    string which(string const& file)
+    {
+        // Paths are used as given rather than searched
+        if (file.find('/') != string::npos) {
+            return is_executable(file) ? file : string();
+        }
+
+        // Use the same default search path as execvp when PATH is not set
+        char const* variable = getenv("PATH");
+        string path = variable ? variable : "/bin:/usr/bin";
+
+        auto& cache = execution_cache::current();
+        string result;
+        if (cache.find_executable(path, file, result)) {
+            return result;
+        }
+
+        for (auto const& directory : split(path, ':', false)) {
+            // An empty directory means the current directory
+            string candidate = directory.empty() ? file : directory + "/" + file;
+            if (is_executable(candidate)) {
+                result = move(candidate);
+                break;
+            }
+        }
+        if (result.empty()) {
+            LOG_DEBUG("%1% was not found in PATH.", file);
+        }
+        cache.store_executable(path, file, result);
+        return result;
+    }
+
+    void clear_which_cache()
+    {
+        execution_cache::current().clear_executables();
+    }
+
+    static bool is_cacheable(function<bool(string&)> const* callback, option_set<execution_options> const& options)
+    {
+        return !callback && options[execution_options::cache_output];
+    }
+
+    static string create_cache_key(
         string const& file,
         vector<string> const* arguments,
         map<string, string> const* environment,
-        function<bool(string&)>* callback,
         option_set<execution_options> const& options)
     {
-        log_execution(file, arguments);
+        // Separate the parts with null characters, which cannot appear in arguments or the environment
+        string key = file;
+        key += '\0';
+        key += to_string(arguments ? arguments->size() : 0);
+        key += '\0';
+        if (arguments) {
+            for (auto const& argument : *arguments) {
+                key += argument;
+                key += '\0';
+            }
+        }
+        key += to_string(environment ? environment->size() : 0);
+        key += '\0';
+        if (environment) {
+            for (auto const& variable : *environment) {
+                key += variable.first;
+                key += '=';
+                key += variable.second;
+                key += '\0';
+            }
+        }
+        key += to_string(static_cast<option_set<execution_options>::value_type>(options));
+        return key;
+    }
 
-        // Create the pipes for stdin/stdout/stderr redirection
-        int pipes[2];
-        if (pipe(pipes) < 0) {
-            throw execution_exception("failed to allocate pipe for input redirection.");
+    void clear_output_cache()
+    {
+        execution_cache::current().clear_output();
+    }
+
+    // Creates a pipe whose descriptors are closed on exec so they do not leak into other children
+    static bool create_pipe(int descriptors[2])
+    {
+#ifdef __linux__
+        return pipe2(descriptors, O_CLOEXEC) == 0;
+#else
+        if (pipe(descriptors) < 0) {
+            return false;
         }
-        scoped_descriptor stdin_read(pipes[0]);
-        scoped_descriptor stdin_write(pipes[1]);
+        fcntl(descriptors[0], F_SETFD, FD_CLOEXEC);
+        fcntl(descriptors[1], F_SETFD, FD_CLOEXEC);
+        return true;
+#endif
+    }
 
-        if (pipe(pipes) < 0) {
-            throw execution_exception("failed to allocate pipe for output redirection.");
+    static vector<string> create_environment(map<string, string> const* environment, option_set<execution_options> const& options)
+    {
+        vector<string> variables;
+
+        // Inherit the current environment unless overridden
+        if (options[execution_options::merge_environment] && environ) {
+            for (auto variable = environ; *variable; ++variable) {
+                char const* equals = strchr(*variable, '=');
+                string name = equals ? string(*variable, equals - *variable) : string(*variable);
+                if (name == "LC_ALL" || name == "LANG" || (environment && environment->count(name))) {
+                    continue;
+                }
+                variables.emplace_back(*variable);
+            }
         }
-        scoped_descriptor stdout_read(pipes[0]);
-        scoped_descriptor stdout_write(pipes[1]);
 
-        // Fork the child process
-        pid_t child = fork();
-        if (child < 0) {
-            throw execution_exception("failed to fork child process.");
+        // Set the locale to C unless specified in the given environment
+        if (!environment || environment->count("LC_ALL") == 0) {
+            variables.emplace_back("LC_ALL=C");
+        }
+        if (!environment || environment->count("LANG") == 0) {
+            variables.emplace_back("LANG=C");
         }
+        if (environment) {
+            for (auto const& variable : *environment) {
+                variables.emplace_back(variable.first + "=" + variable.second);
+            }
+        }
+        return variables;
+    }
 
-        // A non-zero child pid means we're running in the context of the parent process
-        if (child)
-        {
-            // Get a special logger used specifically for child process output
-            auto logger = Logger::getLogger(LOG_ROOT_NAMESPACE "execution.output");
+    // The spawn helper is a small process forked early that spawns children on behalf of this process
+    // Requests are sent over a stream socket as a header carrying the descriptors for the child followed by a body
+    // Each request includes a socket on which the helper replies with the result of spawning and later the child's exit
+    static mutex g_helper_lock;
+    static int g_helper = -1;
+    static pid_t g_helper_pid = 0;
 
-            // Close the unused descriptors
-            stdin_read.release();
-            stdout_write.release();
-            stdin_write.release();
+    // The helper request flags
+    static const uint32_t helper_set_process_group = 1 << 0;
+    static const uint32_t helper_redirect_stderr = 1 << 1;
 
-            ostringstream output;
-            char buffer[4096];
-            bool reading = true;
-            while (reading)
-            {
-                // Read from the pipe
-                auto count = read(stdout_read, buffer, sizeof(buffer));
-                if (count == 0) {
-                    reading = false;
-                    continue;
-                }
-                if (count < 0) {
-                    throw execution_exception("failed to read child output.");
-                }
+    // The maximum number of descriptors sent with a request: the reply socket, stdin, stdout, and stderr
+    static const size_t helper_max_descriptors = 4;
+
+    struct helper_spawn_result
+    {
+        int error;
+        pid_t pid;
+    };
+
+    struct helper_exit_result
+    {
+        int status;
+        rusage usage;
+    };
+
+    static void set_close_on_exec(int descriptor)
+    {
+        fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+    }
 
-                // If given no callback, buffer the entire output
-                if (!callback) {
-                    output.write(buffer, count);
+    static bool write_all(int descriptor, void const* data, size_t size)
+    {
+        auto current = static_cast<char const*>(data);
+        while (size > 0) {
+            auto count = send(descriptor, current, size, MSG_NOSIGNAL);
+            if (count < 0) {
+                if (errno == EINTR) {
                     continue;
                 }
+                return false;
+            }
+            current += count;
+            size -= count;
+        }
+        return true;
+    }
 
-                // Otherwise, scan the output for lines
-                streamsize size = 0;
-                streamsize offset = 0;
-                for (decltype(count) i = 0; reading && i < count; ++i) {
-                    // If not a newline character, increment the size of the data to write
-                    if (buffer[i] != '\n') {
-                        ++size;
-                        continue;
-                    }
+    static bool read_all(int descriptor, void* data, size_t size)
+    {
+        auto current = static_cast<char*>(data);
+        while (size > 0) {
+            auto count = ::read(descriptor, current, size);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                return false;
+            }
+            current += count;
+            size -= count;
+        }
+        return true;
+    }
 
-                    // Skip empty lines
-                    if (size == 0) {
-                        offset = i + 1;
-                        continue;
-                    }
+    // The write end of the helper's self-pipe for SIGCHLD
+    static int g_helper_signal = -1;
 
-                    // Write everything up to the newline to the output stream
-                    output.write(buffer + offset, size);
+    static void helper_signal_child(int)
+    {
+        int saved = errno;
+        char byte = 0;
+        if (write(g_helper_signal, &byte, 1) < 0) {
+            // The pipe is full, so the helper is already going to reap
+        }
+        errno = saved;
+    }
 
-                    // Adjust the offset to continue after the new line character
-                    // and reset the output stream
-                    offset = i + 1;
-                    size = 0;
-                    string line = output.str();
-                    output.str({});
+    // The limits of the helper's storage, which is allocated before the helper is forked
+    // Requests that do not fit are spawned directly by this process instead
+    static const size_t helper_max_request = 256 * 1024;
+    static const size_t helper_max_strings = 16 * 1024;
+    static const size_t helper_max_children = 1024;
 
-                    if (options[execution_options::trim_output]) {
-                        trim(line);
-                    }
+    // The helper is forked from a process that may have other threads, which may hold locks such as the allocator's
+    // It therefore makes only async-signal-safe calls and uses this storage rather than allocating
+    struct helper_storage
+    {
+        char request[helper_max_request];
+        char const* strings[helper_max_strings];
+        pid_t children[helper_max_children];
+        int replies[helper_max_children];
+        size_t child_count;
+    };
 
-                    // Skip empty lines
-                    if (line.empty()) {
-                        continue;
-                    }
+    // Reports that the helper did not spawn the child, so this process should spawn it directly
+    static const int helper_spawn_declined = -1;
 
-                    // Log the line to the output logger
-                    if (logger->isDebugEnabled()) {
-                        log(logger, log_level::debug, line);
-                    }
+    // Receives a request and spawns the child; returns false when this process has closed the socket
+    static bool helper_spawn(int socket, int null, helper_storage& storage)
+    {
+        uint32_t length = 0;
+        iovec io = { &length, sizeof(length) };
+        char control[CMSG_SPACE(sizeof(int) * helper_max_descriptors)];
+        msghdr message = {};
+        message.msg_iov = &io;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
 
-                    // Pass the line to the callback
-                    if (!((*callback)(line))) {
-                        LOG_DEBUG("Completed processing output; closing child pipe.");
-                        reading = false;
-                        break;
+        ssize_t count;
+        do {
+            count = recvmsg(socket, &message, 0);
+        } while (count < 0 && errno == EINTR);
+        if (count <= 0) {
+            return false;
+        }
+
+        int descriptors[helper_max_descriptors] = { -1, -1, -1, -1 };
+        size_t descriptor_count = 0;
+        for (auto header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+                continue;
+            }
+            descriptor_count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            descriptor_count = descriptor_count > helper_max_descriptors ? helper_max_descriptors : descriptor_count;
+            memcpy(descriptors, CMSG_DATA(header), descriptor_count * sizeof(int));
+        }
+        for (size_t i = 0; i < descriptor_count; ++i) {
+            set_close_on_exec(descriptors[i]);
+        }
+        auto close_descriptors = [&]() {
+            for (size_t i = 0; i < descriptor_count; ++i) {
+                close(descriptors[i]);
+            }
+        };
+
+        // The header must be followed by the body, which must fit in the request storage
+        if (count != sizeof(length) || length > sizeof(storage.request) || !read_all(socket, storage.request, length)) {
+            close_descriptors();
+            return false;
+        }
+        if (descriptor_count < 3) {
+            close_descriptors();
+            return true;
+        }
+        int reply = descriptors[0];
+        int input = descriptors[1];
+        int output = descriptors[2];
+        int error_output = descriptors[3];
+
+        // The body is the flags and counts followed by the null-terminated path, arguments, and environment
+        // The arguments and then the environment are stored as lists terminated by a null pointer
+        uint32_t counts[3] = {};
+        helper_spawn_result result = { EINVAL, 0 };
+        char const* path = nullptr;
+        if (length > sizeof(counts) && storage.request[length - 1] == '\0') {
+            memcpy(counts, storage.request, sizeof(counts));
+            size_t arguments = counts[1];
+            size_t variables = counts[2];
+            if (arguments + variables + 2 > helper_max_strings) {
+                result.error = helper_spawn_declined;
+            } else {
+                size_t offset = sizeof(counts);
+                size_t index = 0;
+                for (; offset < length && index <= arguments + variables; ++index) {
+                    char const* current = storage.request + offset;
+                    offset += strlen(current) + 1;
+                    if (index == 0) {
+                        path = current;
+                    } else if (index <= arguments) {
+                        storage.strings[index - 1] = current;
+                    } else {
+                        storage.strings[index] = current;
                     }
                 }
-                // Add the remainder of the buffer to the output stream
-                if (size > 0) {
-                    output.write(buffer + offset, size);
+                if (offset != length || index != arguments + variables + 1) {
+                    path = nullptr;
                 }
+                storage.strings[arguments] = nullptr;
+                storage.strings[arguments + variables + 1] = nullptr;
             }
-
-            // Close the read pipe
-            // If the child hasn't sent all the data yet, this may signal SIGPIPE on next write
-            stdout_read.release();
-
-            string result = output.str();
-            if (options[execution_options::trim_output]) {
-                trim(result);
+        }
+        if (path && storage.child_count == helper_max_children) {
+            result.error = helper_spawn_declined;
+        } else if (path) {
+            // The child inherits the helper's standard descriptors, so spawning needs no file actions, which would allocate
+            dup2(input, STDIN_FILENO);
+            dup2(output, STDOUT_FILENO);
+            if (counts[0] & helper_redirect_stderr && error_output >= 0) {
+                dup2(error_output, STDERR_FILENO);
             }
 
-            // Log the result and do a final callback call if needed
-            if (!result.empty()) {
-                if (logger->isDebugEnabled()) {
-                    log(logger, log_level::debug, result);
-                }
-                if (callback) {
-                    (*callback)(result);
-                    result.clear();
-                }
+            // The helper ignores SIGPIPE, so restore the default for the child
+            posix_spawnattr_t attributes;
+            posix_spawnattr_init(&attributes);
+            sigset_t signals;
+            sigemptyset(&signals);
+            sigaddset(&signals, SIGPIPE);
+            posix_spawnattr_setsigdefault(&attributes, &signals);
+            short flags = POSIX_SPAWN_SETSIGDEF;
+            if (counts[0] & helper_set_process_group) {
+                flags |= POSIX_SPAWN_SETPGROUP;
+                posix_spawnattr_setpgroup(&attributes, 0);
             }
+            posix_spawnattr_setflags(&attributes, flags);
+
+            result.error = posix_spawn(
+                &result.pid,
+                path,
+                nullptr,
+                &attributes,
+                const_cast<char* const*>(storage.strings),
+                const_cast<char* const*>(storage.strings + counts[1] + 1));
 
-            // Wait for the child to exit
-            int status = 0;
-            waitpid(child, &status, 0);
-            if (WIFEXITED(status)) {
-                status = static_cast<char>(WEXITSTATUS(status));
-                LOG_DEBUG("Process exited with status code %1%.", status);
-                if (status != 0 && options[execution_options::throw_on_nonzero_exit]) {
-                    throw child_exit_exception(status, result, "child process returned non-zero exit status.");
+            posix_spawnattr_destroy(&attributes);
+
+            // Point the standard descriptors back at /dev/null
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+
+        close(input);
+        close(output);
+        if (error_output >= 0) {
+            close(error_output);
+        }
+        if (!write_all(reply, &result, sizeof(result)) || result.error != 0) {
+            close(reply);
+            return true;
+        }
+        storage.children[storage.child_count] = result.pid;
+        storage.replies[storage.child_count] = reply;
+        ++storage.child_count;
+        return true;
+    }
+
+    // Closes every descriptor the helper inherited from this process other than the standard descriptors and those given
+    static void close_inherited_descriptors(int socket, int null)
+    {
+        auto inherited = [&](int descriptor) {
+            return descriptor > STDERR_FILENO && descriptor != socket && descriptor != null;
+        };
+
+#ifdef __linux__
+        // List the open descriptors rather than closing every possible one, since the limit may be very large
+        // The directory is read with the system call, since opendir allocates
+        int directory = open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directory >= 0) {
+            struct entry
+            {
+                uint64_t inode;
+                int64_t offset;
+                unsigned short length;
+                unsigned char type;
+                char name[1];
+            };
+            char buffer[4096];
+            bool closed = false;
+            while (true) {
+                auto count = syscall(SYS_getdents64, directory, buffer, sizeof(buffer));
+                if (count < 0 && errno == EINTR) {
+                    continue;
                 }
-            } else if (WIFSIGNALED(status)) {
-                status = static_cast<char>(WTERMSIG(status));
-                LOG_DEBUG("Process was signaled with signal %1%.", status);
-                if (options[execution_options::throw_on_signal]) {
-                    throw child_signal_exception(status, result, "child process was terminated by signal.");
+                if (count <= 0) {
+                    // Closing descriptors changes the directory, so read it again until nothing is left to close
+                    if (count == 0 && closed) {
+                        closed = false;
+                        lseek(directory, 0, SEEK_SET);
+                        continue;
+                    }
+                    break;
+                }
+                for (long offset = 0; offset < count;) {
+                    auto current = reinterpret_cast<entry*>(buffer + offset);
+                    offset += current->length;
+                    if (current->name[0] < '0' || current->name[0] > '9') {
+                        continue;
+                    }
+                    int descriptor = 0;
+                    for (char const* digit = current->name; *digit >= '0' && *digit <= '9'; ++digit) {
+                        descriptor = descriptor * 10 + (*digit - '0');
+                    }
+                    if (inherited(descriptor) && descriptor != directory) {
+                        close(descriptor);
+                        closed = true;
+                    }
                 }
             }
-            return result;
+            close(directory);
+            return;
+        }
+#endif
+        rlimit limit;
+        int maximum = 1024;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+            maximum = static_cast<int>(limit.rlim_cur);
+        }
+        for (int descriptor = STDERR_FILENO + 1; descriptor < maximum; ++descriptor) {
+            if (inherited(descriptor)) {
+                close(descriptor);
+            }
         }
+    }
 
-        // Child continues here
-        try
-        {
-            if (dup2(stdin_read, STDIN_FILENO) == -1) {
-               throw execution_exception("failed to redirect child stdin.");
+    // Runs the helper process; does not return
+    static void run_spawn_helper(int socket, helper_storage& storage)
+    {
+        // Point the standard descriptors at /dev/null so that descriptors received later cannot take their place
+        // The helper also points them at each child's descriptors while spawning it
+        int null = open("/dev/null", O_RDWR);
+        if (null < 0) {
+            _exit(1);
+        }
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        if (null <= STDERR_FILENO) {
+            null = fcntl(null, F_DUPFD, STDERR_FILENO + 1);
+            if (null < 0) {
+                _exit(1);
             }
+        }
+        set_close_on_exec(null);
+
+        // The helper lives as long as this process, so it must not hold this process's descriptors open
+        // Otherwise any descriptor without close-on-exec would also leak into every child it spawns
+        close_inherited_descriptors(socket, null);
 
-            if (dup2(stdout_write, STDOUT_FILENO) == -1) {
-               throw execution_exception("failed to redirect child stdout.");
+        // Restore default signal handling so none of the host's handlers run in the helper
+        for (int signal_number = 1; signal_number < NSIG; ++signal_number) {
+            if (signal_number != SIGKILL && signal_number != SIGSTOP) {
+                signal(signal_number, SIG_DFL);
             }
+        }
+        signal(SIGPIPE, SIG_IGN);
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigprocmask(SIG_SETMASK, &mask, nullptr);
+
+        int signal_pipe[2];
+        if (!create_pipe(signal_pipe)) {
+            _exit(1);
+        }
+        fcntl(signal_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(signal_pipe[1], F_SETFL, O_NONBLOCK);
+        g_helper_signal = signal_pipe[1];
+        signal(SIGCHLD, helper_signal_child);
 
-            if (options[execution_options::redirect_stderr]) {
-                if (dup2(stdout_write, STDERR_FILENO) == -1) {
-                    throw execution_exception("failed to redirect child stderr.");
+        while (true) {
+            pollfd descriptors[2] = {
+                { socket, POLLIN, 0 },
+                { signal_pipe[0], POLLIN, 0 },
+            };
+            if (poll(descriptors, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
                 }
-            } else {
-                // Redirect to null
-                scoped_descriptor dev_null(open("/dev/null", O_RDONLY));
-                if (dev_null < 0 || dup2(dev_null, STDERR_FILENO) == -1) {
-                    throw execution_exception("failed to redirect child stderr to null.");
+                break;
+            }
+            if (descriptors[1].revents) {
+                char buffer[64];
+                while (::read(signal_pipe[0], buffer, sizeof(buffer)) == sizeof(buffer)) {
                 }
+                helper_exit_result result;
+                pid_t pid;
+                while ((pid = wait4(-1, &result.status, WNOHANG, &result.usage)) > 0) {
+                    // Report the exit on the child's reply socket
+                    for (size_t i = 0; i < storage.child_count; ++i) {
+                        if (storage.children[i] != pid) {
+                            continue;
+                        }
+                        write_all(storage.replies[i], &result, sizeof(result));
+                        close(storage.replies[i]);
+                        --storage.child_count;
+                        storage.children[i] = storage.children[storage.child_count];
+                        storage.replies[i] = storage.replies[storage.child_count];
+                        break;
+                    }
+                }
+            }
+            if (descriptors[0].revents && !helper_spawn(socket, null, storage)) {
+                break;
             }
+        }
+
+        // This process has exited or closed the socket; running children are left to finish on their own
+        _exit(0);
+    }
+
+    bool start_spawn_helper()
+    {
+        lock_guard<mutex> lock(g_helper_lock);
+        if (g_helper >= 0) {
+            return true;
+        }
+
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+            LOG_DEBUG("Failed to create the spawn helper socket: %1% (%2%).", strerror(errno), errno);
+            return false;
+        }
+        set_close_on_exec(sockets[0]);
+        set_close_on_exec(sockets[1]);
+#ifdef SO_NOSIGPIPE
+        int enabled = 1;
+        setsockopt(sockets[0], SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
 
-            // Release the parent descriptors before the exec
-            stdin_read.release();
-            stdin_write.release();
-            stdout_read.release();
-            stdout_write.release();
-
-            // Build a vector of pointers to the arguments
-            // The first element is the program name
-            // The given program arguments then follow
-            // The last element is a null to terminate the array
-            vector<char const*> args((arguments ? arguments->size() : 0) + 2 /* argv[0] + null */);
-            args[0] = file.c_str();
-            if (arguments) {
-                for (size_t i = 0; i < arguments->size(); ++i) {
-                    args[i + 1] = arguments->at(i).c_str();
+        // Allocate the helper's storage before forking, since the helper must not allocate
+        unique_ptr<helper_storage> storage(new helper_storage());
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            LOG_DEBUG("Failed to fork the spawn helper: %1% (%2%).", strerror(errno), errno);
+            close(sockets[0]);
+            close(sockets[1]);
+            return false;
+        }
+        if (pid == 0) {
+            close(sockets[0]);
+            run_spawn_helper(sockets[1], *storage);
+        }
+        close(sockets[1]);
+        g_helper = sockets[0];
+        g_helper_pid = pid;
+        LOG_DEBUG("Started spawn helper process %1%.", pid);
+        return true;
+    }
+
+    // Stops using a helper that can no longer be reached; the lock must be held
+    static void abandon_spawn_helper()
+    {
+        LOG_DEBUG("Spawn helper process %1% is no longer running; spawning directly.", g_helper_pid);
+        close(g_helper);
+        g_helper = -1;
+        int status = 0;
+        waitpid(g_helper_pid, &status, WNOHANG);
+        g_helper_pid = 0;
+    }
+
+    // Stops using the given helper after it failed to respond, unless it has already been replaced
+    static void lose_spawn_helper(pid_t helper)
+    {
+        lock_guard<mutex> lock(g_helper_lock);
+        if (g_helper >= 0 && g_helper_pid == helper) {
+            abandon_spawn_helper();
+        }
+    }
+
+    // Spawns a child with the helper; returns -1 if the helper is not running, otherwise the spawn error
+    // On success, the child's exit is reported on the reply socket by the given helper
+    static int spawn_with_helper(
+        string const& executable,
+        vector<char const*> const& args,
+        vector<char const*> const& envp,
+        uint32_t flags,
+        int input,
+        int output,
+        int error_output,
+        pid_t& pid,
+        int& reply,
+        pid_t& helper)
+    {
+        // Requests that do not fit in the helper's storage are spawned directly
+        if (args.size() + envp.size() > helper_max_strings) {
+            return -1;
+        }
+
+        // Serialize the request body
+        uint32_t counts[3] = {
+            flags,
+            static_cast<uint32_t>(args.size() - 1),
+            static_cast<uint32_t>(envp.size() - 1)
+        };
+        string body(reinterpret_cast<char const*>(counts), sizeof(counts));
+        body.append(executable.c_str(), executable.size() + 1);
+        for (auto list : { &args, &envp }) {
+            for (auto value : *list) {
+                if (value) {
+                    body.append(value, strlen(value) + 1);
                 }
             }
+        }
 
-            // Clear the environment if not merging
-            if (!options[execution_options::merge_environment] && environ) {
-                *environ = nullptr;
-            }
+        if (body.size() > helper_max_request) {
+            return -1;
+        }
 
-            // Set the locale to C unless specified in the given environment
-            if (!environment || environment->count("LC_ALL") == 0) {
-                setenv("LC_ALL", "C", 1);
+        int sockets[2];
+        {
+            lock_guard<mutex> lock(g_helper_lock);
+            if (g_helper < 0) {
+                return -1;
             }
-            if (!environment || environment->count("LANG") == 0) {
-                setenv("LANG", "C", 1);
+            helper = g_helper_pid;
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+                return -1;
             }
-            if (environment) {
-                for (auto const& variable : *environment) {
-                    setenv(variable.first.c_str(), variable.second.c_str(), 1);
-                }
+            set_close_on_exec(sockets[0]);
+            set_close_on_exec(sockets[1]);
+            scoped_descriptor remote(sockets[1]);
+
+            // Send the header with the descriptors, then the body
+            int descriptors[helper_max_descriptors] = { sockets[1], input, output, error_output };
+            size_t descriptor_count = error_output >= 0 ? 4 : 3;
+            uint32_t length = body.size();
+            iovec io = { &length, sizeof(length) };
+            char control[CMSG_SPACE(sizeof(int) * helper_max_descriptors)] = {};
+            msghdr message = {};
+            message.msg_iov = &io;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = CMSG_SPACE(sizeof(int) * descriptor_count);
+            auto header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int) * descriptor_count);
+            memcpy(CMSG_DATA(header), descriptors, sizeof(int) * descriptor_count);
+
+            ssize_t count;
+            do {
+                count = sendmsg(g_helper, &message, MSG_NOSIGNAL);
+            } while (count < 0 && errno == EINTR);
+            if (count != sizeof(length) || !write_all(g_helper, body.data(), body.size())) {
+                abandon_spawn_helper();
+                close(sockets[0]);
+                return -1;
             }
+        }
 
-            // Execute the given program and exit in case of failure
-            exit(execvp(file.c_str(), const_cast<char* const*>(args.data())));
+        // Wait for the helper to spawn the child without holding the lock
+        // If the helper exits first, the child may already be running, so it must not be spawned again directly
+        helper_spawn_result result;
+        if (!read_all(sockets[0], &result, sizeof(result))) {
+            close(sockets[0]);
+            lose_spawn_helper(helper);
+            return EPIPE;
         }
-        catch (exception& ex)
-        {
-            // Write out any exception message to "stderr" and exit
-            if (options[execution_options::redirect_stderr]) {
-                string message = ex.what();
-                message += "\n";
-                int result = write(stdout_write, message.c_str(), message.size());
-                if (result == -1) {
-                    // We don't really care if writing the error message failed
-                }
-            }
-            exit(-1);
+        if (result.error != 0) {
+            close(sockets[0]);
+            return result.error == helper_spawn_declined ? -1 : result.error;
         }
+        pid = result.pid;
+        reply = sockets[0];
+        return 0;
+    }
+
+    // Limits the number of child processes running at once across all threads
+    // Waiting launches are served in the order they arrived
+    // A thread that already holds a slot, such as one executing from a line callback, is not made to wait for another
+    static mutex g_slot_lock;
+    static condition_variable g_slot_available;
+    static unsigned int g_process_limit = max(thread::hardware_concurrency(), 1u);
+    static unsigned int g_processes = 0;
+    static uint64_t g_next_ticket = 0;
+    static uint64_t g_serving_ticket = 0;
+    static map<thread::id, unsigned int> g_slot_holders;
+
+    static bool is_slot_free()
+    {
+        return g_process_limit == 0 || g_processes < g_process_limit;
+    }
+
+    void set_process_limit(unsigned int limit)
+    {
+        lock_guard<mutex> lock(g_slot_lock);
+        g_process_limit = limit;
+        g_slot_available.notify_all();
+    }
+
+    unsigned int get_process_limit()
+    {
+        lock_guard<mutex> lock(g_slot_lock);
+        return g_process_limit;
+    }
+
+    // Represents permission to run a child process; the slot is released when this is destroyed
+    struct process_slot
+    {
+        static process_slot acquire();
+        static process_slot try_acquire();
+
+        process_slot();
 
-        // CHILD DOES NOT RETURN
+        process_slot(process_slot const&) = delete;
+        process_slot& operator=(process_slot const&) = delete;
+        process_slot(process_slot&& other);
+        ~process_slot();
+
+        explicit operator bool() const;
+        void release();
+
+     private:
+        // Takes a slot; the lock must be held
+        static process_slot take();
+
+        bool _acquired;
+        thread::id _holder;
+    };
+
+    process_slot::process_slot() :
+        _acquired(false)
+    {
+    }
+
+    process_slot::process_slot(process_slot&& other) :
+        _acquired(other._acquired),
+        _holder(other._holder)
+    {
+        other._acquired = false;
+    }
+
+    process_slot process_slot::take()
+    {
+        process_slot slot;
+        slot._acquired = true;
+        slot._holder = this_thread::get_id();
+        ++g_slot_holders[slot._holder];
+        ++g_processes;
+        return slot;
+    }
+
+    process_slot::~process_slot()
+    {
+        release();
+    }
+
+    process_slot process_slot::acquire()
+    {
+        unique_lock<mutex> lock(g_slot_lock);
+
+        // Waiting while holding a slot could wait forever, since the held slot is released only after this returns
+        if (g_slot_holders.count(this_thread::get_id())) {
+            return take();
+        }
+
+        auto ticket = g_next_ticket++;
+        if (ticket != g_serving_ticket || !is_slot_free()) {
+            auto start = steady_clock::now();
+            g_slot_available.wait(lock, [&]() { return ticket == g_serving_ticket && is_slot_free(); });
+            LOG_DEBUG("Waited %1$.3fs for one of %2% process slots.", duration_cast<duration<double>>(steady_clock::now() - start).count(), g_process_limit);
+        }
+        ++g_serving_ticket;
+
+        // The next launch in line may also fit within the limit
+        g_slot_available.notify_all();
+        return take();
+    }
+
+    process_slot process_slot::try_acquire()
+    {
+        lock_guard<mutex> lock(g_slot_lock);
+
+        // Do not take a slot ahead of launches that are already waiting
+        if (g_next_ticket != g_serving_ticket || !is_slot_free()) {
+            return process_slot();
+        }
+        ++g_next_ticket;
+        ++g_serving_ticket;
+        return take();
+    }
+
+    process_slot::operator bool() const
+    {
+        return _acquired;
+    }
+
+    void process_slot::release()
+    {
+        if (!_acquired) {
+            return;
+        }
+        _acquired = false;
+        lock_guard<mutex> lock(g_slot_lock);
+        --g_processes;
+        auto holder = g_slot_holders.find(_holder);
+        if (holder != g_slot_holders.end() && --holder->second == 0) {
+            g_slot_holders.erase(holder);
+        }
+        g_slot_available.notify_all();
+    }
+
+    // Represents a spawned child process and the state of reading its output
+    struct child_process
+    {
+        child_process(
+            process_slot slot,
+            string const& file,
+            string const& executable,
+            vector<string> const* arguments,
+            map<string, string> const* environment,
+            function<bool(string&)> const* callback,
+            option_set<execution_options> const& options,
+            uint32_t timeout);
+        ~child_process();
+
+        int descriptor() const;
+        int error_descriptor() const;
+        bool reading() const;
+        bool reading_error() const;
+        int remaining(steady_clock::time_point now) const;
+        void kill();
+        void read();
+        void read_error();
+        string finish();
+
+     private:
+        void process_line(char const* begin, char const* end);
+        void stop();
+        int wait();
+        pid_t reap(int& status, int flags);
+        void log_usage(rusage const& usage) const;
+
+        process_slot _slot;
+        string _file;
+        function<bool(string&)> const* _callback;
+        option_set<execution_options> _options;
+        uint32_t _timeout;
+        steady_clock::time_point _start;
+        steady_clock::time_point _deadline;
+        LoggerPtr _logger;
+        pid_t _pid;
+        scoped_descriptor _pipe;
+        scoped_descriptor _error_pipe;
+        scoped_descriptor _reply;
+        pid_t _helper;
+        vector<char> _read_buffer;
+        string _buffer;
+        string _error_buffer;
+        string _line;
+        bool _reading;
+        bool _reading_error;
+        bool _timed_out;
+    };
+
+    child_process::child_process(
+        process_slot slot,
+        string const& file,
+        string const& executable,
+        vector<string> const* arguments,
+        map<string, string> const* environment,
+        function<bool(string&)> const* callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout) :
+            _slot(move(slot)),
+            _file(file),
+            _callback(callback),
+            _options(options),
+            _timeout(timeout),
+            _start(steady_clock::now()),
+            _deadline(_start + seconds(timeout)),
+            _logger(Logger::getLogger(LOG_ROOT_NAMESPACE "execution.output")),
+            _pid(0),
+            _pipe(-1),
+            _error_pipe(-1),
+            _reply(-1),
+            _helper(0),
+            _reading(false),
+            _reading_error(false),
+            _timed_out(false)
+    {
+        log_execution(file, arguments);
+
+        // A missing executable was not given a slot and does not cost a process
+        if (executable.empty()) {
+            LOG_DEBUG("Failed to execute %1%: the executable was not found.", file);
+            return;
+        }
+
+        // Build a vector of pointers to the arguments
+        // The first element is the program name
+        // The given program arguments then follow
+        // The last element is a null to terminate the array
+        vector<char const*> args((arguments ? arguments->size() : 0) + 2 /* argv[0] + null */);
+        args[0] = file.c_str();
+        if (arguments) {
+            for (size_t i = 0; i < arguments->size(); ++i) {
+                args[i + 1] = arguments->at(i).c_str();
+            }
+        }
+
+        // Build the child's environment in the parent; the child only execs
+        auto variables = create_environment(environment, options);
+        vector<char const*> envp(variables.size() + 1 /* null */);
+        for (size_t i = 0; i < variables.size(); ++i) {
+            envp[i] = variables[i].c_str();
+        }
+
+        // Create the pipes for stdin/stdout/stderr redirection
+        int pipes[2];
+        if (!create_pipe(pipes)) {
+            throw execution_exception("failed to allocate pipe for input redirection.");
+        }
+        scoped_descriptor stdin_read(pipes[0]);
+        scoped_descriptor stdin_write(pipes[1]);
+
+        if (!create_pipe(pipes)) {
+            throw execution_exception("failed to allocate pipe for output redirection.");
+        }
+        _pipe = scoped_descriptor(pipes[0]);
+        scoped_descriptor stdout_write(pipes[1]);
+
+        bool capture_stderr = options[execution_options::capture_stderr] && !options[execution_options::redirect_stderr];
+        scoped_descriptor stderr_write(-1);
+        if (capture_stderr) {
+            if (!create_pipe(pipes)) {
+                throw execution_exception("failed to allocate pipe for error redirection.");
+            }
+            _error_pipe = scoped_descriptor(pipes[0]);
+            stderr_write = scoped_descriptor(pipes[1]);
+        }
+
+        // Redirect the child's stdin and stdout to the pipes and stderr to stdout, its own pipe, or null
+        posix_spawn_file_actions_t actions;
+        if (posix_spawn_file_actions_init(&actions) != 0) {
+            throw execution_exception("failed to initialize child file actions.");
+        }
+        scoped_resource<posix_spawn_file_actions_t*> actions_resource(&actions, [](posix_spawn_file_actions_t*& actions) {
+            posix_spawn_file_actions_destroy(actions);
+        });
+        if (posix_spawn_file_actions_adddup2(&actions, stdin_read, STDIN_FILENO) != 0) {
+            throw execution_exception("failed to redirect child stdin.");
+        }
+        if (posix_spawn_file_actions_adddup2(&actions, stdout_write, STDOUT_FILENO) != 0) {
+            throw execution_exception("failed to redirect child stdout.");
+        }
+        if (options[execution_options::redirect_stderr]) {
+            if (posix_spawn_file_actions_adddup2(&actions, stdout_write, STDERR_FILENO) != 0) {
+                throw execution_exception("failed to redirect child stderr.");
+            }
+        } else if (capture_stderr) {
+            if (posix_spawn_file_actions_adddup2(&actions, stderr_write, STDERR_FILENO) != 0) {
+                throw execution_exception("failed to redirect child stderr.");
+            }
+        } else if (posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0) != 0) {
+            throw execution_exception("failed to redirect child stderr to null.");
+        }
+
+        // Restore the default SIGPIPE action in case the host process ignores it
+        posix_spawnattr_t attributes;
+        if (posix_spawnattr_init(&attributes) != 0) {
+            throw execution_exception("failed to initialize child attributes.");
+        }
+        scoped_resource<posix_spawnattr_t*> attributes_resource(&attributes, [](posix_spawnattr_t*& attributes) {
+            posix_spawnattr_destroy(attributes);
+        });
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGPIPE);
+        short flags = POSIX_SPAWN_SETSIGDEF;
+
+        // With a timeout, put the child in its own process group so the whole group can be killed on expiry
+        if (_timeout) {
+            flags |= POSIX_SPAWN_SETPGROUP;
+            if (posix_spawnattr_setpgroup(&attributes, 0) != 0) {
+                throw execution_exception("failed to set child process group.");
+            }
+        }
+        if (posix_spawnattr_setsigdefault(&attributes, &signals) != 0 ||
+            posix_spawnattr_setflags(&attributes, flags) != 0) {
+            throw execution_exception("failed to set child attributes.");
+        }
+
+        // Spawn the child process with the helper if it is running
+        uint32_t helper_flags = _timeout ? helper_set_process_group : 0;
+        int error_output = -1;
+        if (options[execution_options::redirect_stderr]) {
+            error_output = stdout_write;
+        } else if (capture_stderr) {
+            error_output = stderr_write;
+        }
+        if (error_output >= 0) {
+            helper_flags |= helper_redirect_stderr;
+        }
+        int reply = -1;
+        int error = spawn_with_helper(executable, args, envp, helper_flags, stdin_read, stdout_write, error_output, _pid, reply, _helper);
+        if (error < 0) {
+            // Unlike fork, this does not copy the parent's address space, so the cost does not depend on the parent's size
+            error = posix_spawn(
+                &_pid,
+                executable.c_str(),
+                &actions,
+                &attributes,
+                const_cast<char* const*>(args.data()),
+                const_cast<char* const*>(envp.data()));
+        } else if (error == 0) {
+            _reply = scoped_descriptor(reply);
+        }
+
+        // Close the descriptors used by the child
+        stdin_read.release();
+        stdout_write.release();
+        stderr_write.release();
+        stdin_write.release();
+
+        if (error != 0) {
+            LOG_DEBUG("Failed to execute %1%: %2% (%3%).", file, strerror(error), error);
+            _pid = 0;
+            _pipe.release();
+            _error_pipe.release();
+            return;
+        }
+        _reading = true;
+        _reading_error = capture_stderr;
+    }
+
+    child_process::~child_process()
+    {
+        // Reap a child that was not finished, such as when reading from another child failed
+        if (_pid) {
+            _pipe.release();
+            _error_pipe.release();
+            wait();
+        }
+    }
+
+    int child_process::descriptor() const
+    {
+        return _pipe;
+    }
+
+    int child_process::error_descriptor() const
+    {
+        return _error_pipe;
+    }
+
+    bool child_process::reading() const
+    {
+        return _reading;
+    }
+
+    bool child_process::reading_error() const
+    {
+        return _reading_error;
+    }
+
+    void child_process::stop()
+    {
+        // Stop reading stderr too; the child may be blocked writing output that will no longer be read
+        _reading = false;
+        _reading_error = false;
+    }
+
+    int child_process::remaining(steady_clock::time_point now) const
+    {
+        if (!_timeout) {
+            return -1;
+        }
+        if (now >= _deadline) {
+            return 0;
+        }
+        // Round up so the deadline has passed when a poll with the remaining time returns
+        return static_cast<int>(duration_cast<milliseconds>(_deadline - now).count()) + 1;
+    }
+
+    void child_process::kill()
+    {
+        if (!_pid || _timed_out) {
+            return;
+        }
+        LOG_DEBUG("Process %1% did not complete within %2% seconds; killing its process group.", _pid, _timeout);
+        ::kill(-_pid, SIGKILL);
+        _timed_out = true;
+        stop();
+    }
+
+    int child_process::wait()
+    {
+        int status = 0;
+        pid_t result;
+        if (!_timeout) {
+            result = reap(status, 0);
+        } else {
+            // The child may have closed its output without exiting, so keep enforcing the deadline
+            while (true) {
+                result = reap(status, WNOHANG);
+                if (result == _pid || result < 0) {
+                    break;
+                }
+                if (remaining(steady_clock::now()) == 0) {
+                    kill();
+                    result = reap(status, 0);
+                    break;
+                }
+                this_thread::sleep_for(milliseconds(10));
+            }
+        }
+        _pid = 0;
+        _slot.release();
+
+        // The exit status is lost if the child could not be reaped, such as when the spawn helper stopped running
+        return result < 0 ? -1 : status;
+    }
+
+    pid_t child_process::reap(int& status, int flags)
+    {
+        // A child spawned by the helper is the helper's child, so the helper reports its exit
+        if (_reply >= 0) {
+            helper_exit_result exit;
+            ssize_t count;
+            do {
+                count = recv(_reply, &exit, sizeof(exit), MSG_WAITALL | ((flags & WNOHANG) ? MSG_DONTWAIT : 0));
+            } while (count < 0 && errno == EINTR);
+            if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return 0;
+            }
+            if (count != sizeof(exit)) {
+                LOG_DEBUG("Spawn helper did not report the exit of process %1%.", _pid);
+                lose_spawn_helper(_helper);
+                return -1;
+            }
+            status = exit.status;
+            log_usage(exit.usage);
+            return _pid;
+        }
+
+        rusage usage;
+        pid_t result;
+        do {
+            result = wait4(_pid, &status, flags, &usage);
+        } while (result < 0 && errno == EINTR);
+
+        if (result == _pid) {
+            log_usage(usage);
+        }
+        return result;
+    }
+
+    void child_process::log_usage(rusage const& usage) const
+    {
+        if (!LOG_IS_DEBUG_ENABLED()) {
+            return;
+        }
+        auto wall = duration_cast<duration<double>>(steady_clock::now() - _start).count();
+        auto user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0;
+        auto system = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+        auto memory = static_cast<int64_t>(usage.ru_maxrss);
+#ifdef __APPLE__
+        // OSX reports the maximum resident set size in bytes rather than kilobytes
+        memory /= 1024;
+#endif
+        LOG_DEBUG("Process %1% (%2%) took %3$.3fs (%4$.3fs user, %5$.3fs system) with a maximum resident set size of %6% KiB.", _pid, _file, wall, user, system, memory);
+    }
+
+    void child_process::read_error()
+    {
+        if (_read_buffer.empty()) {
+            _read_buffer.resize(64 * 1024);
+        }
+        auto count = ::read(_error_pipe, _read_buffer.data(), _read_buffer.size());
+        if (count == 0) {
+            _reading_error = false;
+            return;
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                return;
+            }
+            throw execution_exception("failed to read child error output.");
+        }
+        _error_buffer.append(_read_buffer.data(), count);
+    }
+
+    // Matches the default set of characters removed by trim
+    static bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    void child_process::read()
+    {
+        // Read into a buffer that is reused for the life of the child
+        if (_read_buffer.empty()) {
+            _read_buffer.resize(64 * 1024);
+        }
+        auto count = ::read(_pipe, _read_buffer.data(), _read_buffer.size());
+        if (count == 0) {
+            _reading = false;
+            return;
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                return;
+            }
+            throw execution_exception("failed to read child output.");
+        }
+
+        // If given no callback, buffer the entire output
+        if (!_callback) {
+            _buffer.append(_read_buffer.data(), count);
+            return;
+        }
+
+        // Otherwise, scan the output for lines
+        // Lines are processed in place; only a line that continues into the next read is buffered
+        char const* current = _read_buffer.data();
+        char const* end = current + count;
+        while (_reading && current < end) {
+            auto newline = static_cast<char const*>(memchr(current, '\n', end - current));
+            if (!newline) {
+                _buffer.append(current, end);
+                break;
+            }
+            if (_buffer.empty()) {
+                process_line(current, newline);
+            } else {
+                _buffer.append(current, newline);
+                process_line(_buffer.data(), _buffer.data() + _buffer.size());
+                _buffer.clear();
+            }
+            current = newline + 1;
+        }
+    }
+
+    void child_process::process_line(char const* begin, char const* end)
+    {
+        if (_options[execution_options::trim_output]) {
+            while (begin < end && is_space(*begin)) {
+                ++begin;
+            }
+            while (end > begin && is_space(*(end - 1))) {
+                --end;
+            }
+        }
+
+        // Skip empty lines
+        if (begin == end) {
+            return;
+        }
+
+        // The line string is reused so its storage is only allocated for the longest line
+        _line.assign(begin, end);
+
+        // Log the line to the output logger
+        if (_logger->isDebugEnabled()) {
+            log(_logger, log_level::debug, _line);
+        }
+
+        // Pass the line to the callback
+        if (!((*_callback)(_line))) {
+            LOG_DEBUG("Completed processing output; closing child pipe.");
+            stop();
+        }
+    }
+
+    string child_process::finish()
+    {
+        // Treat a failure to spawn the same as a shell would: exit status 127 with no output
+        if (!_pid) {
+            _slot.release();
+            LOG_DEBUG("Process exited with status code %1%.", 127);
+            if (_options[execution_options::throw_on_nonzero_exit]) {
+                throw child_exit_exception(127, {}, "child process returned non-zero exit status.");
+            }
+            return {};
+        }
+
+        // Close the read pipes
+        // If the child hasn't sent all the data yet, this may signal SIGPIPE on next write
+        _pipe.release();
+        _error_pipe.release();
+        stop();
+
+        // Log any captured error output separately from the output
+        trim(_error_buffer);
+        if (!_error_buffer.empty()) {
+            auto logger = Logger::getLogger(LOG_ROOT_NAMESPACE "execution.error");
+            if (logger->isDebugEnabled()) {
+                log(logger, log_level::debug, _error_buffer);
+            }
+        }
+
+        if (_timed_out) {
+            wait();
+            throw timeout_exception("child process did not complete within " + to_string(_timeout) + " seconds.");
+        }
+
+        string result = move(_buffer);
+        _buffer.clear();
+        if (_options[execution_options::trim_output]) {
+            trim(result);
+        }
+
+        // Log the result and do a final callback call if needed
+        if (!result.empty()) {
+            if (_logger->isDebugEnabled()) {
+                log(_logger, log_level::debug, result);
+            }
+            if (_callback) {
+                (*_callback)(result);
+                result.clear();
+            }
+        }
+
+        // Wait for the child to exit
+        int status = wait();
+        if (_timed_out) {
+            throw timeout_exception("child process did not complete within " + to_string(_timeout) + " seconds.");
+        }
+        if (status < 0) {
+            // Treat a lost exit status the same as a failure to spawn rather than as success
+            LOG_DEBUG("Process exited with status code %1%.", 127);
+            if (_options[execution_options::throw_on_nonzero_exit]) {
+                throw child_exit_exception(127, result, "child process returned non-zero exit status.");
+            }
+        } else if (WIFEXITED(status)) {
+            status = static_cast<char>(WEXITSTATUS(status));
+            LOG_DEBUG("Process exited with status code %1%.", status);
+            if (status != 0 && _options[execution_options::throw_on_nonzero_exit]) {
+                throw child_exit_exception(status, result, "child process returned non-zero exit status.");
+            }
+        } else if (WIFSIGNALED(status)) {
+            status = static_cast<char>(WTERMSIG(status));
+            LOG_DEBUG("Process was signaled with signal %1%.", status);
+            if (_options[execution_options::throw_on_signal]) {
+                throw child_signal_exception(status, result, "child process was terminated by signal.");
+            }
+        }
+        return result;
+    }
+
+    // The longest a partial read waits before returning so that free process slots are noticed
+    static const int slot_poll_interval = 100;
+
+    // Reads the output of the given children until every pipe is closed or every child has timed out
+    // A partial read instead returns once any child is done or after waiting for a short interval
+    static void read_output(vector<child_process*> const& children, bool partial = false)
+    {
+        vector<pollfd> descriptors;
+        vector<pair<child_process*, bool>> readers;
+        while (true) {
+            descriptors.clear();
+            readers.clear();
+            int timeout = partial ? slot_poll_interval : -1;
+            auto now = steady_clock::now();
+            for (auto child : children) {
+                if (!child->reading() && !child->reading_error()) {
+                    if (partial) {
+                        return;
+                    }
+                    continue;
+                }
+                int remaining = child->remaining(now);
+                if (remaining == 0) {
+                    child->kill();
+                    continue;
+                }
+                if (remaining > 0 && (timeout < 0 || remaining < timeout)) {
+                    timeout = remaining;
+                }
+                if (child->reading()) {
+                    descriptors.push_back({ child->descriptor(), POLLIN, 0 });
+                    readers.emplace_back(child, false);
+                }
+                if (child->reading_error()) {
+                    descriptors.push_back({ child->error_descriptor(), POLLIN, 0 });
+                    readers.emplace_back(child, true);
+                }
+            }
+            if (descriptors.empty()) {
+                break;
+            }
+            int result = poll(descriptors.data(), descriptors.size(), timeout);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw execution_exception("failed to poll child output.");
+            }
+            if (partial && result == 0) {
+                return;
+            }
+            for (size_t i = 0; result > 0 && i < descriptors.size(); ++i) {
+                if (!descriptors[i].revents) {
+                    continue;
+                }
+                // A callback may have stopped reading from the child since the poll
+                auto child = readers[i].first;
+                if (readers[i].second) {
+                    if (child->reading_error()) {
+                        child->read_error();
+                    }
+                } else if (child->reading()) {
+                    child->read();
+                }
+            }
+        }
+    }
+
+    static string execute(
+        string const& file,
+        vector<string> const* arguments,
+        map<string, string> const* environment,
+        function<bool(string&)> const* callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
+    {
+        string key;
+        if (is_cacheable(callback, options)) {
+            key = create_cache_key(file, arguments, environment, options);
+            string output;
+            if (execution_cache::current().find_output(key, output)) {
+                log_execution(file, arguments);
+                LOG_DEBUG("Using cached output.");
+                return output;
+            }
+        }
+
+        // Search for the executable in the parent so that a missing program neither waits for a slot nor costs a process
+        string executable = which(file);
+        child_process child(executable.empty() ? process_slot() : process_slot::acquire(), file, executable, arguments, environment, callback, options, timeout);
+        read_output({ &child });
+        auto output = child.finish();
+
+        // Failures are not cached because they throw
+        if (!key.empty()) {
+            execution_cache::current().store_output(key, output);
+        }
+        return output;
+    }
+
+    string execute(
+        string const& file,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
+    {
+        return execute(file, nullptr, nullptr, nullptr, options, timeout);
+    }
+
+    string execute(
+        string const& file,
+        vector<string> const& arguments,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
+    {
+        return execute(file, &arguments, nullptr, nullptr, options, timeout);
+    }
+
+    string execute(
+        string const& file,
+        vector<string> const& arguments,
+        map<string, string> const& environment,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
+    {
+        return execute(file, &arguments, &environment, nullptr, options, timeout);
+    }
+
+    void each_line(
+        string const& file,
+        function<bool(string&)> callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
+    {
+        execute(file, nullptr, nullptr, &callback, options, timeout);
+    }
+
+    void each_line(
+        string const& file,
+        vector<string> const& arguments,
+        function<bool(string&)> callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
+    {
+        execute(file, &arguments, nullptr, &callback, options, timeout);
+    }
+
+    void each_line(
+        string const& file,
+        vector<string> const& arguments,
+        map<string, string> const& environment,
+        function<bool(string&)> callback,
+        option_set<execution_options> const& options,
+        uint32_t timeout)
+    {
+        execute(file, &arguments, &environment, &callback, options, timeout);
+    }
+
+    command::command(string file, vector<string> arguments, option_set<execution_options> options, uint32_t timeout) :
+        file(move(file)),
+        arguments(move(arguments)),
+        options(move(options)),
+        timeout(timeout)
+    {
+    }
+
+    vector<string> execute_many(vector<command> const& commands, vector<exception_ptr>* failures)
+    {
+        if (failures) {
+            failures->assign(commands.size(), nullptr);
+        }
+        vector<string> results(commands.size());
+        vector<string> keys(commands.size());
+        vector<unique_ptr<child_process>> children(commands.size());
+        vector<size_t> running;
+        vector<child_process*> pointers;
+        exception_ptr failure;
+        size_t failure_index = 0;
+        size_t next = 0;
+        while (next < commands.size() || !running.empty()) {
+            // Spawn children while process slots are free so they run concurrently; commands with cached output are not spawned
+            // Only wait for a slot when none of this batch's children are running, since running children release their slots only when reaped here
+            for (; next < commands.size(); ++next) {
+                auto const& cmd = commands[next];
+                auto callback = cmd.callback ? &cmd.callback : nullptr;
+                if (is_cacheable(callback, cmd.options)) {
+                    keys[next] = create_cache_key(cmd.file, &cmd.arguments, &cmd.environment, cmd.options);
+                    if (execution_cache::current().find_output(keys[next], results[next])) {
+                        log_execution(cmd.file, &cmd.arguments);
+                        LOG_DEBUG("Using cached output.");
+                        keys[next].clear();
+                        continue;
+                    }
+                }
+                string executable = which(cmd.file);
+                auto slot = executable.empty() ? process_slot() : running.empty() ? process_slot::acquire() : process_slot::try_acquire();
+                if (!executable.empty() && !slot) {
+                    break;
+                }
+                children[next].reset(new child_process(move(slot), cmd.file, executable, &cmd.arguments, &cmd.environment, callback, cmd.options, cmd.timeout));
+                running.push_back(next);
+            }
+
+            // Read from whichever children have output; when commands are waiting, return as soon as a child is done
+            pointers.clear();
+            for (auto i : running) {
+                pointers.push_back(children[i].get());
+            }
+            read_output(pointers, next < commands.size());
+
+            // Reap the children that are done, releasing their slots, before reporting the first failure
+            for (auto it = running.begin(); it != running.end();) {
+                auto& child = children[*it];
+                if (child->reading() || child->reading_error()) {
+                    ++it;
+                    continue;
+                }
+                try {
+                    results[*it] = child->finish();
+                    if (!keys[*it].empty()) {
+                        execution_cache::current().store_output(keys[*it], results[*it]);
+                    }
+                } catch (execution_exception&) {
+                    // Keep the failure of the first command rather than the first child to finish
+                    if (failures) {
+                        (*failures)[*it] = current_exception();
+                    } else if (!failure || *it < failure_index) {
+                        failure = current_exception();
+                        failure_index = *it;
+                    }
+                }
+                child.reset();
+                it = running.erase(it);
+            }
+        }
+        if (failure) {
+            rethrow_exception(failure);
+        }
+        return results;
     }
 
 }}  // namespace facter::executions
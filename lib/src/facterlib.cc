@@ -2,9 +2,17 @@
 #include <facter/version.h>
 #include <facter/facts/fact_map.hpp>
 #include <facter/facts/value.hpp>
+#include <facter/facts/snapshot.hpp>
+#include <facter/execution/execution.hpp>
 #include <facter/util/string.hpp>
+#include <facter/logging/logging.hpp>
 #include <log4cxx/logger.h>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <sstream>
+#include <cstring>
 #include <vector>
 #include <string>
 
@@ -13,8 +21,97 @@ using namespace facter::util;
 using namespace facter::facts;
 using namespace log4cxx;
 
-static unique_ptr<fact_map> g_facts;
-static vector<string> g_external_directories;
+LOG_DECLARE_NAMESPACE("facterlib");
+
+// Stores the state for a context; all access must hold the lock
+struct facter_context
+{
+    facter_context() :
+        legacy_strings(false),
+        loading(false),
+        cancelled(false)
+    {
+    }
+
+    ~facter_context()
+    {
+        // Wait for any asynchronous load to finish since it references the context
+        // The context may be freed from the completion callback, which runs on the loader thread after the load is done
+        if (loader.joinable()) {
+            if (loader.get_id() == this_thread::get_id()) {
+                loader.detach();
+            } else {
+                loader.join();
+            }
+        }
+    }
+
+    unique_ptr<fact_map> facts;
+    vector<string> external_directories;
+    bool legacy_strings;
+    string digest;
+    thread loader;
+    bool loading;
+    bool cancelled;
+    condition_variable loaded;
+    mutex lock;
+};
+
+static facter_context g_context;
+
+static void disable_logging()
+{
+    // TODO: figure out a callback mechanism for log output
+    // Until then, disable logging when using the C interface
+    static once_flag flag;
+    call_once(flag, []() {
+        if (Logger::getRootLogger()->getAllAppenders().size() == 0) {
+            Logger::getRootLogger()->setLevel(Level::getOff());
+        }
+    });
+}
+
+static set<string> parse_names(char const* names)
+{
+    set<string> requested_facts;
+    if (names) {
+        for (auto& name : split(names, ',')) {
+            requested_facts.emplace(trim(to_lower(move(name))));
+        }
+    }
+    return requested_facts;
+}
+
+static unique_ptr<fact_map> resolve_facts(set<string> const& requested_facts, vector<string> const& external_directories, bool legacy_strings)
+{
+    // Each fact map has its own cache of executables and program output, so a new load does not reuse results of the last
+    unique_ptr<fact_map> facts(new fact_map());
+    facts->legacy_strings(legacy_strings);
+    facts->resolve(requested_facts);
+
+    // Load external facts
+    facts->resolve_external(external_directories, requested_facts);
+    return facts;
+}
+
+// Copies the given string to a buffer that the caller frees with free_facts_buffer
+static char* to_buffer(string const& str)
+{
+    char* buffer = new char[str.size() + 1];
+    memcpy(buffer, str.c_str(), str.size() + 1);
+    return buffer;
+}
+
+static value const* get_value(facter_context* context, string const& name)
+{
+    // Getting a value may resolve more facts, which changes the digest
+    auto size = context->facts->size();
+    auto val = (*context->facts)[name];
+    if (context->facts->size() != size) {
+        context->digest.clear();
+    }
+    return val;
+}
 
 extern "C" {
     char const* get_facter_version()
@@ -24,56 +121,332 @@ extern "C" {
 
     void load_facts(char const* names)
     {
-        // TODO: figure out a callback mechanism for log output
-        // Until then, disable logging when using the C interface
-        if (Logger::getRootLogger()->getAllAppenders().size() == 0) {
-            Logger::getRootLogger()->setLevel(Level::getOff());
+        facter_load_facts(&g_context, names);
+    }
+
+    bool load_facts_async(char const* names, void(*callback)(bool loaded, void* userdata), void* userdata)
+    {
+        return facter_load_facts_async(&g_context, names, callback, userdata);
+    }
+
+    void wait_facts()
+    {
+        facter_wait_facts(&g_context);
+    }
+
+    void cancel_load_facts()
+    {
+        facter_cancel_load_facts(&g_context);
+    }
+
+    void refresh_facts(char const* names)
+    {
+        facter_refresh_facts(&g_context, names);
+    }
+
+    bool load_snapshot(char const* path, char const* names)
+    {
+        return facter_load_snapshot(&g_context, path, names);
+    }
+
+    bool write_snapshot(char const* path)
+    {
+        return facter_write_snapshot(&g_context, path);
+    }
+
+    void clear_facts()
+    {
+        facter_clear_facts(&g_context);
+    }
+
+    void enumerate_facts(enumeration_callbacks* callbacks)
+    {
+        facter_enumerate_facts(&g_context, callbacks);
+    }
+
+    bool get_fact_value(char const* name, enumeration_callbacks* callbacks)
+    {
+        return facter_get_fact_value(&g_context, name, callbacks);
+    }
+
+    size_t get_fact_values(char const* const* names, size_t count, enumeration_callbacks* callbacks)
+    {
+        return facter_get_fact_values(&g_context, names, count, callbacks);
+    }
+
+    char* get_facts_json(char const* names)
+    {
+        return facter_get_facts_json(&g_context, names);
+    }
+
+    void free_facts_buffer(char* buffer)
+    {
+        delete[] buffer;
+    }
+
+    char* get_facts_digest()
+    {
+        return facter_get_facts_digest(&g_context);
+    }
+
+    void enumerate_fact_digests(void(*callback)(char const* name, char const* digest))
+    {
+        facter_enumerate_fact_digests(&g_context, callback);
+    }
+
+    void set_legacy_strings(bool enabled)
+    {
+        facter_set_legacy_strings(&g_context, enabled);
+    }
+
+    bool start_spawn_helper()
+    {
+        return facter::execution::start_spawn_helper();
+    }
+
+    void set_process_limit(unsigned int limit)
+    {
+        facter::execution::set_process_limit(limit);
+    }
+
+    void search_external(char const* directories)
+    {
+        facter_search_external(&g_context, directories);
+    }
+
+    void reset_external()
+    {
+        facter_reset_external(&g_context);
+    }
+
+    facter_context* facter_create()
+    {
+        return new facter_context();
+    }
+
+    void facter_free(facter_context* context)
+    {
+        delete context;
+    }
+
+    void facter_load_facts(facter_context* context, char const* names)
+    {
+        if (!context) {
+            return;
         }
 
-        g_facts.reset(new fact_map());
+        disable_logging();
+
+        auto requested_facts = parse_names(names);
+
+        vector<string> external_directories;
+        bool legacy_strings;
+        {
+            lock_guard<mutex> lock(context->lock);
+            external_directories = context->external_directories;
+            legacy_strings = context->legacy_strings;
+        }
+
+        // Resolve without holding the lock so the previous facts can still be queried
+        auto facts = resolve_facts(requested_facts, external_directories, legacy_strings);
+
+        lock_guard<mutex> lock(context->lock);
+        context->facts = move(facts);
+        context->digest.clear();
+    }
+
+    bool facter_load_facts_async(facter_context* context, char const* names, void(*callback)(bool loaded, void* userdata), void* userdata)
+    {
+        if (!context) {
+            return false;
+        }
+
+        disable_logging();
+
+        auto requested_facts = parse_names(names);
+
+        thread previous;
+        {
+            lock_guard<mutex> lock(context->lock);
+            if (context->loading) {
+                return false;
+            }
+
+            // The thread of the previous load may still be running its completion callback, which can lock the context
+            // Reap it after releasing the lock
+            previous = move(context->loader);
+
+            context->loading = true;
+            context->cancelled = false;
+            auto external_directories = context->external_directories;
+            auto legacy_strings = context->legacy_strings;
 
-        set<string> requested_facts;
-        if (names) {
-            for (auto& name : split(names, ',')) {
-                requested_facts.emplace(trim(to_lower(move(name))));
+            context->loader = thread([=]() {
+                // An exception must not escape the thread, and waiters must still be woken if the load fails
+                // The previously loaded facts are kept if the load fails
+                unique_ptr<fact_map> facts;
+                try {
+                    facts = resolve_facts(requested_facts, external_directories, legacy_strings);
+                } catch (exception& ex) {
+                    LOG_ERROR("failed to load facts: %1%", ex.what());
+                } catch (...) {
+                    LOG_ERROR("failed to load facts.");
+                }
+                bool loaded = static_cast<bool>(facts);
+
+                bool cancelled;
+                {
+                    lock_guard<mutex> lock(context->lock);
+                    cancelled = context->cancelled;
+                    if (!cancelled && loaded) {
+                        context->facts = move(facts);
+                        context->digest.clear();
+                    }
+                    context->loading = false;
+                    context->loaded.notify_all();
+                }
+
+                // Call back without holding the lock so the callback can query the facts
+                if (!cancelled && callback) {
+                    callback(loaded, userdata);
+                }
+            });
+        }
+
+        // The previous load may be the calling thread if called from the completion callback
+        if (previous.joinable()) {
+            if (previous.get_id() == this_thread::get_id()) {
+                previous.detach();
+            } else {
+                previous.join();
             }
         }
+        return true;
+    }
 
-        // Resolve facts
-        g_facts->resolve(requested_facts);
+    void facter_wait_facts(facter_context* context)
+    {
+        if (!context) {
+            return;
+        }
 
-        // Load external facts
-        g_facts->resolve_external(g_external_directories, requested_facts);
+        unique_lock<mutex> lock(context->lock);
+        context->loaded.wait(lock, [&]() { return !context->loading; });
     }
 
-    void clear_facts()
+    void facter_cancel_load_facts(facter_context* context)
     {
-        if (!g_facts) {
+        if (!context) {
             return;
         }
-        g_facts.reset(nullptr);
+
+        lock_guard<mutex> lock(context->lock);
+        if (context->loading) {
+            context->cancelled = true;
+        }
     }
 
-    void enumerate_facts(enumeration_callbacks* callbacks)
+    void facter_refresh_facts(facter_context* context, char const* names)
+    {
+        if (!context || !names) {
+            return;
+        }
+
+        auto requested_facts = parse_names(names);
+
+        lock_guard<mutex> lock(context->lock);
+        if (!context->facts) {
+            return;
+        }
+
+        context->facts->refresh(requested_facts);
+        context->digest.clear();
+    }
+
+    bool facter_load_snapshot(facter_context* context, char const* path, char const* names)
+    {
+        if (!context || !path) {
+            return false;
+        }
+
+        disable_logging();
+
+        auto requested_facts = parse_names(names);
+
+        unique_ptr<fact_map> facts(new fact_map());
+        facts->clear();
+        try {
+            snapshot(path).populate(*facts, requested_facts);
+        } catch (snapshot_exception&) {
+            return false;
+        }
+
+        lock_guard<mutex> lock(context->lock);
+        context->facts = move(facts);
+        context->digest.clear();
+        return true;
+    }
+
+    bool facter_write_snapshot(facter_context* context, char const* path)
     {
-        if (!g_facts || !callbacks) {
+        if (!context || !path) {
+            return false;
+        }
+
+        lock_guard<mutex> lock(context->lock);
+        if (!context->facts) {
+            return false;
+        }
+
+        try {
+            snapshot::write(path, *context->facts);
+        } catch (snapshot_exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    void facter_clear_facts(facter_context* context)
+    {
+        if (!context) {
+            return;
+        }
+
+        lock_guard<mutex> lock(context->lock);
+        context->facts.reset(nullptr);
+        context->digest.clear();
+    }
+
+    void facter_enumerate_facts(facter_context* context, enumeration_callbacks* callbacks)
+    {
+        if (!context || !callbacks) {
             return;
         }
-        g_facts->each([&](string const& name, value const* val) {
+
+        lock_guard<mutex> lock(context->lock);
+        if (!context->facts) {
+            return;
+        }
+        context->facts->each([&](string const& name, value const* val) {
             val->notify(name, callbacks);
             return true;
         });
     }
 
-    bool get_fact_value(char const* name, enumeration_callbacks* callbacks)
+    bool facter_get_fact_value(facter_context* context, char const* name, enumeration_callbacks* callbacks)
     {
-        if (!g_facts || !name || !callbacks) {
+        if (!context || !name || !callbacks) {
+            return false;
+        }
+
+        lock_guard<mutex> lock(context->lock);
+        if (!context->facts) {
             return false;
         }
 
         // Get the fact
         string fact = trim(to_lower(name));
-        auto val = (*g_facts)[fact];
+        auto val = get_value(context, fact);
         if (!val) {
             return false;
         }
@@ -83,14 +456,134 @@ extern "C" {
         return true;
     }
 
-    void search_external(char const* directories)
+    size_t facter_get_fact_values(facter_context* context, char const* const* names, size_t count, enumeration_callbacks* callbacks)
+    {
+        if (!context || !names || !callbacks) {
+            return 0;
+        }
+
+        vector<string> facts;
+        facts.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            facts.emplace_back(names[i] ? trim(to_lower(names[i])) : string());
+        }
+
+        lock_guard<mutex> lock(context->lock);
+        if (!context->facts) {
+            return 0;
+        }
+
+        // Resolve everything that is needed up front rather than one fact at a time
+        auto size = context->facts->size();
+        context->facts->resolve_concurrently(set<string>(facts.begin(), facts.end()));
+        if (context->facts->size() != size) {
+            context->digest.clear();
+        }
+
+        size_t found = 0;
+        for (auto const& fact : facts) {
+            auto val = get_value(context, fact);
+            if (!val) {
+                continue;
+            }
+            val->notify(fact, callbacks);
+            ++found;
+        }
+        return found;
+    }
+
+    char* facter_get_facts_json(facter_context* context, char const* names)
+    {
+        if (!context) {
+            return nullptr;
+        }
+
+        auto requested_facts = parse_names(names);
+
+        lock_guard<mutex> lock(context->lock);
+        if (!context->facts) {
+            return nullptr;
+        }
+
+        // Resolve any requested facts that have not yet been resolved
+        for (auto const& name : requested_facts) {
+            get_value(context, name);
+        }
+
+        ostringstream stream;
+        context->facts->write_json_compact(stream, requested_facts);
+        return to_buffer(stream.str());
+    }
+
+    char* facter_get_facts_digest(facter_context* context)
+    {
+        if (!context) {
+            return nullptr;
+        }
+
+        lock_guard<mutex> lock(context->lock);
+        if (!context->facts) {
+            return nullptr;
+        }
+
+        // The digest is cached until the facts change
+        if (context->digest.empty()) {
+            auto digest = context->facts->digest();
+            context->digest = to_hex(digest.data(), digest.size());
+        }
+
+        // The cached digest changes when facts are loaded or resolved on other threads, so return a copy
+        return to_buffer(context->digest);
+    }
+
+    void facter_enumerate_fact_digests(facter_context* context, void(*callback)(char const* name, char const* digest))
     {
-        if (!directories) {
+        if (!context || !callback) {
             return;
         }
 
+        lock_guard<mutex> lock(context->lock);
+        if (!context->facts) {
+            return;
+        }
+        context->facts->each_digest([&](string const& name, sha256_digest const& digest) {
+            callback(name.c_str(), to_hex(digest.data(), digest.size()).c_str());
+            return true;
+        });
+    }
+
+    void facter_set_legacy_strings(facter_context* context, bool enabled)
+    {
+        if (!context) {
+            return;
+        }
+
+        lock_guard<mutex> lock(context->lock);
+        context->legacy_strings = enabled;
+        if (context->facts) {
+            context->facts->legacy_strings(enabled);
+        }
+    }
+
+    void facter_search_external(facter_context* context, char const* directories)
+    {
+        if (!context || !directories) {
+            return;
+        }
+
+        lock_guard<mutex> lock(context->lock);
         for (auto& directory : split(directories, ':')) {
-            g_external_directories.emplace_back(move(directory));
+            context->external_directories.emplace_back(move(directory));
         }
     }
+
+    void facter_reset_external(facter_context* context)
+    {
+        if (!context) {
+            return;
+        }
+
+        lock_guard<mutex> lock(context->lock);
+        context->external_directories.clear();
+    }
 }
@@ -6,6 +6,7 @@
 #include <yaml-cpp/yaml.h>
 
 using namespace std;
+using namespace facter::util;
 using namespace rapidjson;
 using namespace YAML;
 
@@ -35,11 +36,7 @@ namespace facter { namespace facts {
 
     void array_value::each(function<bool(value const*)> func) const
     {
-        for (auto const& element : _elements) {
-            if (!func(element.get())) {
-                break;
-            }
-        }
+        each<function<bool(value const*)>&>(func);
     }
 
     void array_value::to_json(Allocator& allocator, rapidjson::Value& value) const
@@ -74,6 +71,26 @@ namespace facter { namespace facts {
         }
     }
 
+    sha256_digest array_value::digest() const
+    {
+        sha256 hash;
+        hash.update("a", 1);
+        for (auto const& element : _elements) {
+            hash.update(element->digest());
+        }
+        return hash.finish();
+    }
+
+    value_kind array_value::kind() const
+    {
+        return value_kind::array;
+    }
+
+    void array_value::accept(value_visitor& visitor) const
+    {
+        visitor.visit(*this);
+    }
+
     value const* array_value::operator[](size_t i) const
     {
         return _elements.at(i).get();
@@ -90,7 +107,7 @@ namespace facter { namespace facts {
             } else {
                 os << ", ";
             }
-            bool quote = dynamic_cast<string_value const*>(element.get());
+            bool quote = element->kind() == value_kind::string;
             if (quote) {
                 os << '"';
             }
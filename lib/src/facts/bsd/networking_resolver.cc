@@ -68,6 +68,19 @@ namespace facter { namespace facts { namespace bsd {
         auto dhcp_servers_value = make_value<map_value>();
         auto dhcp_servers = find_dhcp_servers();
 
+        // Query the remaining interfaces' DHCP servers all at once
+        vector<string> unknown_interfaces;
+        for (auto it = interface_map.begin(); it != interface_map.end(); it = interface_map.upper_bound(it->first)) {
+            if (dhcp_servers.count(it->first) == 0) {
+                unknown_interfaces.push_back(it->first);
+            }
+        }
+        if (!unknown_interfaces.empty()) {
+            for (auto& server : query_dhcp_servers(unknown_interfaces)) {
+                dhcp_servers.insert(move(server));
+            }
+        }
+
         // Walk the interfaces
         decltype(interface_map.begin()) addr_it;
         for (auto it = interface_map.begin(); it != interface_map.end(); it = addr_it) {
@@ -103,18 +116,14 @@ namespace facter { namespace facts { namespace bsd {
             }
 
             // Populate the interface's DHCP server value
-            string dhcp_server;
             auto dhcp_server_it = dhcp_servers.find(interface);
-            if (dhcp_server_it == dhcp_servers.end()) {
-                dhcp_server = find_dhcp_server(interface);
-            } else {
-                dhcp_server = move(dhcp_server_it->second);
-            }
-            if (!dhcp_server.empty()) {
+            if (dhcp_server_it != dhcp_servers.end() && !dhcp_server_it->second.empty()) {
+                // The primary interface's server is shared with the system entry
+                auto server = make_shared<string const>(move(dhcp_server_it->second));
                 if (primary) {
-                    dhcp_servers_value->add("system", make_value<string_value>(dhcp_server));
+                    dhcp_servers_value->add("system", make_value<string_value>(server));
                 }
-                dhcp_servers_value->add(string(interface), make_value<string_value>(move(dhcp_server)));
+                dhcp_servers_value->add(string(interface), make_value<string_value>(move(server)));
             }
 
             // Add the interface to the interfaces fact
@@ -172,11 +181,13 @@ namespace facter { namespace facts { namespace bsd {
             return;
         }
 
+        // The primary interface's value is shared with the interface-specific fact
+        auto value = make_shared<string const>(move(address));
         if (primary) {
-            facts.add(move(factname), make_value<string_value>(address));
+            facts.add(move(factname), make_value<string_value>(value));
         }
 
-        facts.add(move(interface_factname), make_value<string_value>(move(address)));
+        facts.add(move(interface_factname), make_value<string_value>(move(value)));
     }
 
     void networking_resolver::resolve_network(fact_map& facts, ifaddrs const* addr, bool primary)
@@ -197,15 +208,16 @@ namespace facter { namespace facts { namespace bsd {
             return;
         }
 
+        auto netmask_value = make_shared<string const>(move(netmask));
         if (primary) {
-            facts.add(move(factname), make_value<string_value>(netmask));
+            facts.add(move(factname), make_value<string_value>(netmask_value));
         }
 
-        facts.add(move(interface_factname), make_value<string_value>(move(netmask)));
+        facts.add(move(interface_factname), make_value<string_value>(move(netmask_value)));
 
         // Set the network fact
         factname = addr->ifa_addr->sa_family == AF_INET ? fact::network : fact::network6;
-        string network = address_to_string(addr->ifa_addr, addr->ifa_netmask);
+        auto network = make_shared<string const>(address_to_string(addr->ifa_addr, addr->ifa_netmask));
         interface_factname = factname + "_" + addr->ifa_name;
 
         if (primary) {
@@ -226,7 +238,7 @@ namespace facter { namespace facts { namespace bsd {
         if (mtu == -1) {
             return;
         }
-        facts.add(string(fact::mtu) + '_' + addr->ifa_name, make_value<string_value>(to_string(mtu)));
+        facts.add(string(fact::mtu) + '_' + addr->ifa_name, make_value<integer_value>(static_cast<int64_t>(mtu)));
     }
 
     string networking_resolver::get_primary_interface()
@@ -283,19 +295,25 @@ namespace facter { namespace facts { namespace bsd {
         return servers;
     }
 
-    string networking_resolver::find_dhcp_server(string const& interface)
+    map<string, string> networking_resolver::query_dhcp_servers(vector<string> const& interfaces)
     {
-        // Use dhcpcd if it's present to get the interface's DHCP lease information
-        // This assumes we've already searched for the interface with dhclient
-        string value;
-        execution::each_line("dhcpcd", { "-U", interface }, [&value](string& line) {
-            if (starts_with(line, "dhcp_server_identifier=")) {
-                value = trim(line.substr(23));
-                return false;
-            }
-            return true;
-        });
-        return value;
+        // Use dhcpcd if it's present to get each interface's DHCP lease information
+        // This assumes we've already searched for the interfaces with dhclient
+        map<string, string> servers;
+        vector<command> commands;
+        commands.reserve(interfaces.size());
+        for (auto const& interface : interfaces) {
+            commands.emplace_back("dhcpcd", vector<string>{ "-U", interface });
+            commands.back().callback = [&servers, &interface](string& line) {
+                if (starts_with(line, "dhcp_server_identifier=")) {
+                    servers.emplace(interface, trim(line.substr(23)));
+                    return false;
+                }
+                return true;
+            };
+        }
+        execute_many(commands);
+        return servers;
     }
 
 }}}  // namespace facter::facts::bsd
@@ -70,7 +70,7 @@ namespace facter { namespace facts { namespace external {
         void String(char const* s, SizeType len, bool copy)
         {
             // If the stack is empty or the top is a map and we don't have a key yet, set the key
-            if ((_stack.empty() || dynamic_cast<map_value*>(get<1>(_stack.top()).get())) && _key.empty()) {
+            if ((_stack.empty() || get<1>(_stack.top())->kind() == value_kind::map) && _key.empty()) {
                 check_initialized();
                 _key = s;
                 return;
@@ -142,17 +142,15 @@ namespace facter { namespace facts { namespace external {
             // If there's an array or map on the stack, add the value as an element
             auto& top = _stack.top();
             auto& current = get<1>(top);
-            auto array = dynamic_cast<array_value*>(current.get());
-            if (array) {
-                array->add(move(val));
+            if (current->kind() == value_kind::array) {
+                static_cast<array_value*>(current.get())->add(move(val));
                 return;
             }
-            auto map = dynamic_cast<map_value*>(current.get());
-            if (map) {
+            if (current->kind() == value_kind::map) {
                 if (_key.empty()) {
                     throw external::external_fact_exception("expected non-empty key in object.");
                 }
-                map->add(move(_key), move(val));
+                static_cast<map_value*>(current.get())->add(move(_key), move(val));
             }
         }
 
@@ -169,15 +167,28 @@ namespace facter { namespace facts { namespace external {
         stack<tuple<string, unique_ptr<value>>> _stack;
     };
 
-    bool json_resolver::resolve(string const& path, fact_map& facts) const
+    bool json_resolver::can_resolve(string const& path) const
     {
         string full_path = path;
-        if (!ends_with(to_lower(full_path), ".json")) {
+        return ends_with(to_lower(full_path), ".json");
+    }
+
+    bool json_resolver::resolve(string const& path, fact_map& facts) const
+    {
+        if (!can_resolve(path)) {
             return false;
         }
 
         LOG_DEBUG("resolving facts from JSON file \"%1%\".", path);
 
+        read(path, facts);
+
+        LOG_DEBUG("completed resolving facts from JSON file \"%1%\".", path);
+        return true;
+    }
+
+    void json_resolver::read(string const& path, fact_map& facts)
+    {
         // Open the file
         // We used a scoped_file here because rapidjson expects a FILE*
         scoped_file file(path, "r");
@@ -195,9 +206,6 @@ namespace facter { namespace facts { namespace external {
         if (reader.HasParseError()) {
             throw external_fact_exception(reader.GetParseError());
         }
-
-        LOG_DEBUG("completed resolving facts from JSON file \"%1%\".", path);
-        return true;
     }
 
 }}}  // namespace facter::facts::external
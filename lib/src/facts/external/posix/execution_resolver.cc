@@ -18,6 +18,62 @@ LOG_DECLARE_NAMESPACE("facts.external.execution.posix");
 
 namespace facter { namespace facts { namespace external {
 
+    execution_resolver::execution_resolver(uint32_t timeout) :
+        _timeout(timeout)
+    {
+    }
+
+    bool execution_resolver::can_resolve(string const& path) const
+    {
+        return true;
+    }
+
+    void execution_resolver::prepare(vector<string> const& paths)
+    {
+        _results.clear();
+
+        option_set<execution_options> options = { execution_options::defaults, execution_options::throw_on_failure, execution_options::capture_stderr };
+        vector<string> executables;
+        vector<command> commands;
+        for (auto const& path : paths) {
+            if (access(path.c_str(), X_OK) == -1) {
+                continue;
+            }
+            executables.push_back(path);
+            commands.emplace_back(path, vector<string>(), options, _timeout);
+        }
+        if (commands.empty()) {
+            return;
+        }
+
+        // Each command gets the storage for its output before any of them run
+        for (auto const& path : executables) {
+            _results[path];
+        }
+        for (size_t i = 0; i < commands.size(); ++i) {
+            auto& lines = _results[executables[i]].lines;
+            commands[i].callback = [&lines](string& line) {
+                lines.push_back(move(line));
+                return true;
+            };
+        }
+
+        LOG_DEBUG("executing %1% external fact executables.", commands.size());
+
+        vector<exception_ptr> failures;
+        try {
+            execute_many(commands, &failures);
+        } catch (execution_exception& ex) {
+            // The files are executed one at a time when resolved instead
+            LOG_DEBUG("failed to execute external fact executables: %1%", ex.what());
+            _results.clear();
+            return;
+        }
+        for (size_t i = 0; i < commands.size(); ++i) {
+            _results[executables[i]].failure = failures[i];
+        }
+    }
+
     bool execution_resolver::resolve(string const& path, fact_map& facts) const
     {
         if (access(path.c_str(), X_OK) == -1) {
@@ -28,20 +84,34 @@ namespace facter { namespace facts { namespace external {
 
         LOG_DEBUG("resolving facts from executable file \"%1%\".", path);
 
+        auto add = [&facts](string const& line) {
+            auto pos = line.find('=');
+            if (pos == string::npos) {
+                LOG_DEBUG("ignoring line in output: %1%", line);
+                return true;
+            }
+            // Add as a string fact
+            facts.add(line.substr(0, pos), make_value<string_value>(line.substr(pos+1)));
+            return true;
+        };
+
         try
         {
-            execution::each_line(path, [&facts](string const& line) {
-                auto pos = line.find('=');
-                if (pos == string::npos) {
-                    LOG_DEBUG("ignoring line in output: %1%", line);
-                    return true;
+            // Use the output of the file if it was executed by prepare
+            auto it = _results.find(path);
+            if (it != _results.end()) {
+                if (it->second.failure) {
+                    rethrow_exception(it->second.failure);
                 }
-                // Add as a string fact
-                facts.add(line.substr(0, pos), make_value<string_value>(line.substr(pos+1)));
-                return true;
-            }, { execution_options::defaults, execution_options::throw_on_failure });
+                for (auto const& line : it->second.lines) {
+                    add(line);
+                }
+            } else {
+                execution::each_line(path, add, { execution_options::defaults, execution_options::throw_on_failure, execution_options::capture_stderr }, _timeout);
+            }
         }
         catch (execution_exception& ex) {
+            // This includes executables that were killed after timing out; the remaining external facts still resolve
             throw external_fact_exception(ex.what());
         }
 
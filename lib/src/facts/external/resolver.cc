@@ -9,4 +9,12 @@ namespace facter { namespace facts { namespace external {
     {
     }
 
+    resolver::~resolver()
+    {
+    }
+
+    void resolver::prepare(vector<string> const& paths)
+    {
+    }
+
 }}}  // namespace facter::facts::external
@@ -12,10 +12,15 @@ LOG_DECLARE_NAMESPACE("facts.external.text");
 
 namespace facter { namespace facts { namespace external {
 
-    bool text_resolver::resolve(string const& path, fact_map& facts) const
+    bool text_resolver::can_resolve(string const& path) const
     {
         string full_path = path;
-        if (!ends_with(to_lower(full_path), ".txt")) {
+        return ends_with(to_lower(full_path), ".txt");
+    }
+
+    bool text_resolver::resolve(string const& path, fact_map& facts) const
+    {
+        if (!can_resolve(path)) {
             return false;
         }
 
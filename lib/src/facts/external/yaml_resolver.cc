@@ -49,6 +49,7 @@ namespace facter { namespace facts { namespace external {
         } else if (node.IsMap()) {
             // For maps, convert to a map value
             auto map = make_value<map_value>();
+            map->reserve(node.size());
             for (auto const& child : node) {
                 add_value(child.first.as<string>(), child.second, facts, nullptr, map.get());
             }
@@ -68,10 +69,15 @@ namespace facter { namespace facts { namespace external {
         }
     }
 
-    bool yaml_resolver::resolve(string const& path, fact_map& facts) const
+    bool yaml_resolver::can_resolve(string const& path) const
     {
         string full_path = path;
-        if (!ends_with(to_lower(full_path), ".yaml")) {
+        return ends_with(to_lower(full_path), ".yaml");
+    }
+
+    bool yaml_resolver::resolve(string const& path, fact_map& facts) const
+    {
+        if (!can_resolve(path)) {
             return false;
         }
 
@@ -1,16 +1,28 @@
 #include <facter/facts/fact_map.hpp>
 #include <facter/facts/fact_resolver.hpp>
+#include <facter/facts/fact.hpp>
 #include <facter/facts/value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/facts/external/resolver.hpp>
+#include <facter/execution/execution.hpp>
 #include <facter/logging/logging.hpp>
+#include <facter/util/string.hpp>
 #include <boost/filesystem.hpp>
 #include <algorithm>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cmath>
+#include <locale>
+#include <sstream>
 #include <rapidjson/document.h>
 #include <rapidjson/prettywriter.h>
 #include <yaml-cpp/yaml.h>
 
 using namespace std;
+using namespace facter::util;
+using namespace facter::execution;
 using namespace rapidjson;
 using namespace YAML;
 using namespace boost::filesystem;
@@ -44,17 +56,39 @@ namespace facter { namespace facts {
      */
     extern vector<unique_ptr<external::resolver>> get_external_resolvers();
 
+    // Determines if the given resolver resolves the given fact, by name or by pattern
+    static bool is_responsible(fact_resolver const& resolver, string const& name)
+    {
+        auto const& names = resolver.names();
+        return find(names.begin(), names.end(), name) != names.end() || resolver.can_resolve(name);
+    }
+
     resolver_exists_exception::resolver_exists_exception(string const& message) :
         runtime_error(message)
     {
     }
 
-    fact_map::fact_map()
+    fact_map::fact_map() :
+        _streaming(false),
+        _resolving_external(false),
+        _legacy_strings(false),
+        _delegate(nullptr),
+        _execution_cache(new execution_cache())
     {
         populate_common_facts(*this);
         populate_platform_facts(*this);
     }
 
+    fact_map::fact_map(delegated_resolution* delegate) :
+        _streaming(false),
+        _resolving_external(false),
+        _legacy_strings(false),
+        _delegate(delegate)
+    {
+        // Maps used for concurrent resolution or refresh have no resolvers; facts they do not have are looked up through the delegate
+        // Their resolvers execute programs with the cache of the map being resolved
+    }
+
     fact_map::~fact_map()
     {
         // This needs to be defined here since we use incomplete types in the header
@@ -74,10 +108,36 @@ namespace facter { namespace facts {
             _resolver_map.insert(it, make_pair(fact_name, resolver));
         }
         _resolvers.push_back(resolver);
+
+        // Keep the resolver after it runs so that its facts can be refreshed
+        _added_resolvers.push_back(resolver);
+    }
+
+    // Determines if the fact was resolved as a string before it was resolved as an integer
+    static bool is_legacy_string(string const& name)
+    {
+        return name == fact::processor_count ||
+               name == fact::physical_processor_count ||
+               name == fact::selinux_policyversion ||
+               name == fact::lsb_dist_major_release ||
+               name == fact::lsb_dist_minor_release ||
+               starts_with(name, string(fact::mtu) + "_");
     }
 
     void fact_map::add(string&& name, unique_ptr<value>&& value)
     {
+        // When streaming, remember the fact so it can be written once the current resolver completes
+        if (_streaming) {
+            _pending.insert(name);
+        }
+
+        // Remember external facts so they are not replaced when refreshing built-in facts
+        if (_resolving_external) {
+            _external.insert(name);
+        } else if (_legacy_strings && value && value->kind() == value_kind::integer && is_legacy_string(name)) {
+            value = make_value<string_value>(to_string(static_cast<integer_value const*>(value.get())->value()));
+        }
+
         // Search for the fact first
         auto const& it = _facts.lower_bound(name);
         if (it != _facts.end() && !(_facts.key_comp()(name, it->first))) {
@@ -139,7 +199,9 @@ namespace facter { namespace facts {
     void fact_map::clear()
     {
         _facts.clear();
+        _external.clear();
         _resolvers.clear();
+        _added_resolvers.clear();
         _resolver_map.clear();
     }
 
@@ -163,6 +225,10 @@ namespace facter { namespace facts {
         if (resolved()) {
             return;
         }
+
+        // Programs executed by the resolvers share this map's cache rather than that of other maps
+        execution_cache::scope scope(*_execution_cache);
+
         if (!facts.empty()) {
             // Resolve the given facts
             for (auto const& fact : facts) {
@@ -252,18 +318,34 @@ namespace facter { namespace facts {
         sort(files.begin(), files.end());
 
         // For each file, find a resolver for it
+        // Each resolver is given its files first so it can start the work for all of them together (e.g. run executables concurrently)
+        vector<external::resolver*> owners;
         for (auto const& file : files) {
-            try
-            {
-                bool resolved = false;
-                for (auto const& resolver : resolvers) {
-                    if (resolver->resolve(file, *this)) {
-                        resolved = true;
-                        break;
-                    }
+            auto it = find_if(resolvers.begin(), resolvers.end(), [&](unique_ptr<external::resolver> const& resolver) {
+                return resolver->can_resolve(file);
+            });
+            owners.push_back(it == resolvers.end() ? nullptr : it->get());
+        }
+
+        execution_cache::scope scope(*_execution_cache);
+        for (auto const& resolver : resolvers) {
+            vector<string> owned;
+            for (size_t i = 0; i < files.size(); ++i) {
+                if (owners[i] == resolver.get()) {
+                    owned.push_back(files[i]);
                 }
+            }
+            if (!owned.empty()) {
+                resolver->prepare(owned);
+            }
+        }
 
-                if (!resolved) {
+        _resolving_external = true;
+        for (size_t i = 0; i < files.size(); ++i) {
+            auto const& file = files[i];
+            try
+            {
+                if (!owners[i] || !owners[i]->resolve(file, *this)) {
                     LOG_DEBUG("file \"%1%\" is not supported for external facts.", file);
                     continue;
                 }
@@ -272,6 +354,7 @@ namespace facter { namespace facts {
                 LOG_ERROR("error while processing \"%1%\" for external facts: %2%", file, ex.what());
             }
         }
+        _resolving_external = false;
 
         // Remove facts that resolved but aren't in the filter
         if (!facts.empty()) {
@@ -286,6 +369,375 @@ namespace facter { namespace facts {
         }
     }
 
+    void fact_map::legacy_strings(bool enabled)
+    {
+        _legacy_strings = enabled;
+    }
+
+    bool fact_map::legacy_strings() const
+    {
+        return _legacy_strings;
+    }
+
+    // Supplies the facts that a map used by resolve_concurrently or refresh does not have
+    struct fact_map::delegated_resolution
+    {
+        virtual ~delegated_resolution()
+        {
+        }
+
+        virtual value const* get(string const& name, bool resolve) = 0;
+    };
+
+    // Serves the facts requested by the resolvers being refreshed
+    // Facts of the resolvers being refreshed are resolved again into a separate map; all other facts come from the map being refreshed
+    struct fact_map::refresh_resolution : delegated_resolution
+    {
+        refresh_resolution(fact_map& parent, vector<shared_ptr<fact_resolver>> const& resolvers) :
+            parent(parent),
+            resolvers(resolvers),
+            facts(this)
+        {
+            facts._legacy_strings = parent._legacy_strings;
+        }
+
+        // Runs the given resolver unless it has already run; a resolver that requests its own facts while running is a cycle
+        void run(shared_ptr<fact_resolver> const& resolver)
+        {
+            if (find(refreshed.begin(), refreshed.end(), resolver) != refreshed.end()) {
+                return;
+            }
+            LOG_DEBUG("refreshing %1% facts.", resolver->name());
+            resolver->resolve(facts);
+            refreshed.push_back(resolver);
+        }
+
+        virtual value const* get(string const& name, bool resolve)
+        {
+            for (auto const& resolver : resolvers) {
+                if (!is_responsible(*resolver, name)) {
+                    continue;
+                }
+                if (!resolve && find(refreshed.begin(), refreshed.end(), resolver) == refreshed.end()) {
+                    return nullptr;
+                }
+                run(resolver);
+                auto it = facts._facts.find(name);
+                return it == facts._facts.end() ? nullptr : it->second.get();
+            }
+            return parent.get_value(name, resolve);
+        }
+
+        fact_map& parent;
+        vector<shared_ptr<fact_resolver>> const& resolvers;
+        vector<shared_ptr<fact_resolver>> refreshed;
+        fact_map facts;
+    };
+
+    void fact_map::refresh(set<string> const& facts)
+    {
+        // Refreshed facts must not reuse the output of programs executed before the refresh
+        _execution_cache.reset(new execution_cache());
+        execution_cache::scope scope(*_execution_cache);
+
+        // Find the resolvers responsible for the facts among those added to this map, including those that have already run
+        // Facts loaded without resolvers, such as from a snapshot, are refreshed with the built-in resolvers
+        unique_ptr<fact_map> builtin;
+        vector<shared_ptr<fact_resolver>> resolvers;
+        for (auto const& name : facts) {
+            auto it = find_if(_added_resolvers.begin(), _added_resolvers.end(), [&](shared_ptr<fact_resolver> const& resolver) {
+                return is_responsible(*resolver, name);
+            });
+            shared_ptr<fact_resolver> resolver;
+            if (it != _added_resolvers.end()) {
+                resolver = *it;
+            } else {
+                if (!builtin) {
+                    builtin.reset(new fact_map());
+                }
+                resolver = builtin->find_resolver(name);
+            }
+            if (!resolver) {
+                LOG_DEBUG("fact \"%1%\" cannot be refreshed because it has no resolver.", name);
+                continue;
+            }
+            if (find(resolvers.begin(), resolvers.end(), resolver) != resolvers.end()) {
+                continue;
+            }
+            resolvers.push_back(resolver);
+        }
+
+        // Resolve into a separate map so that the facts being replaced are not read while they are refreshed
+        refresh_resolution refresh(*this, resolvers);
+        for (auto const& resolver : resolvers) {
+            refresh.run(resolver);
+        }
+
+        merge(refresh.facts, resolvers);
+
+        // The facts are now resolved, so remove any of this map's resolvers for them
+        for (auto const& resolver : resolvers) {
+            remove(resolver);
+        }
+        for (auto const& name : facts) {
+            auto resolver = find_resolver(name);
+            if (resolver) {
+                remove(resolver);
+            }
+        }
+    }
+
+    // Tracks the resolvers of a map that is being resolved concurrently
+    // Each resolver runs at most once, on the first thread that needs it, into its own map
+    // The map's own facts and resolvers are only read while resolvers are running
+    struct fact_map::concurrent_resolution : delegated_resolution
+    {
+        struct resolution
+        {
+            resolution() :
+                done(false)
+            {
+            }
+
+            unique_ptr<fact_map> facts;
+            thread::id runner;
+            bool done;
+        };
+
+        explicit concurrent_resolution(fact_map& parent) :
+            parent(parent)
+        {
+        }
+
+        // Runs the given resolver unless it has already run or is running, then waits for it to finish
+        resolution& run(shared_ptr<fact_resolver> const& resolver, unique_lock<mutex>& guard)
+        {
+            auto& current = resolutions[resolver];
+            while (!current.done) {
+                if (!current.facts) {
+                    current.facts.reset(new fact_map(this));
+                    current.facts->_legacy_strings = parent._legacy_strings;
+                    current.runner = this_thread::get_id();
+                    auto facts = current.facts.get();
+
+                    guard.unlock();
+                    try {
+                        resolver->resolve(*facts);
+                    } catch (...) {
+                        guard.lock();
+                        current.done = true;
+                        finished.notify_all();
+                        throw;
+                    }
+                    guard.lock();
+                    current.done = true;
+                    finished.notify_all();
+                    break;
+                }
+
+                // Waiting for a resolver that is itself waiting on this thread would never finish
+                auto self = this_thread::get_id();
+                for (auto runner = current.runner;;) {
+                    if (runner == self) {
+                        throw circular_resolution_exception("a cycle in fact resolution was detected.");
+                    }
+                    auto it = waiting.find(runner);
+                    if (it == waiting.end()) {
+                        break;
+                    }
+                    runner = resolutions[it->second].runner;
+                }
+                waiting[self] = resolver;
+                finished.wait(guard);
+                waiting.erase(self);
+            }
+            return current;
+        }
+
+        // Gets a fact for a resolver that is running concurrently
+        virtual value const* get(string const& name, bool resolve)
+        {
+            unique_lock<mutex> guard(lock);
+            auto it = parent._facts.find(name);
+            if (it != parent._facts.end()) {
+                return it->second.get();
+            }
+            auto resolver = parent.find_resolver(name);
+            if (!resolver) {
+                return nullptr;
+            }
+            auto existing = resolutions.find(resolver);
+            if (!resolve && (existing == resolutions.end() || !existing->second.done)) {
+                return nullptr;
+            }
+            auto& facts = run(resolver, guard).facts->_facts;
+            it = facts.find(name);
+            return it == facts.end() ? nullptr : it->second.get();
+        }
+
+        fact_map& parent;
+        mutex lock;
+        condition_variable finished;
+        map<shared_ptr<fact_resolver>, resolution> resolutions;
+        map<thread::id, shared_ptr<fact_resolver>> waiting;
+    };
+
+    void fact_map::resolve_concurrently(set<string> const& facts)
+    {
+        // Plan the resolvers needed for the facts that have not yet been resolved
+        vector<shared_ptr<fact_resolver>> resolvers;
+        for (auto const& name : facts) {
+            if (_facts.count(name)) {
+                continue;
+            }
+            auto resolver = find_resolver(name);
+            if (!resolver || find(resolvers.begin(), resolvers.end(), resolver) != resolvers.end()) {
+                continue;
+            }
+            resolvers.push_back(resolver);
+        }
+
+        // The names of the built-in resolvers are gathered once
+        static set<string> const builtin = []() {
+            set<string> names;
+            fact_map builtin_facts;
+            for (auto const& resolver : builtin_facts._resolvers) {
+                names.insert(resolver->name());
+            }
+            return names;
+        }();
+
+        // Programs executed by the resolvers on every thread share this map's cache
+        execution_cache::scope scope(*_execution_cache);
+
+        // Resolvers that are not built-in may not be safe to run on other threads, so run them first on this thread
+        vector<shared_ptr<fact_resolver>> concurrent;
+        for (auto const& resolver : resolvers) {
+            if (resolvers.size() > 1 && builtin.count(resolver->name())) {
+                concurrent.push_back(resolver);
+                continue;
+            }
+
+            // The resolver may have already resolved as a dependency of another resolver
+            if (find(_resolvers.begin(), _resolvers.end(), resolver) != _resolvers.end()) {
+                resolver->resolve(*this);
+                remove(resolver);
+            }
+        }
+        if (concurrent.empty()) {
+            return;
+        }
+
+        concurrent_resolution coordinator(*this);
+        {
+            vector<future<void>> results;
+            for (auto const& resolver : concurrent) {
+                if (find(_resolvers.begin(), _resolvers.end(), resolver) == _resolvers.end()) {
+                    continue;
+                }
+                results.emplace_back(async(launch::async, [this, &coordinator, resolver]() {
+                    execution_cache::scope scope(*_execution_cache);
+                    unique_lock<mutex> guard(coordinator.lock);
+                    coordinator.run(resolver, guard);
+                }));
+            }
+
+            // Wait for every thread before reporting the first failure
+            exception_ptr failure;
+            for (auto& result : results) {
+                try {
+                    result.get();
+                } catch (...) {
+                    if (!failure) {
+                        failure = current_exception();
+                    }
+                }
+            }
+            if (failure) {
+                rethrow_exception(failure);
+            }
+        }
+
+        // Add the facts of every resolver that ran, including those run as dependencies
+        for (auto& kvp : coordinator.resolutions) {
+            if (kvp.second.facts) {
+                merge(*kvp.second.facts, { kvp.first });
+            }
+            remove(kvp.first);
+        }
+    }
+
+    void fact_map::stream(function<void(string const&, value const*)> func, vector<string> const& directories, bool external)
+    {
+        // Resolve external facts first as they take precedence over built-in facts
+        // Keep the resolver mappings so that built-in facts of the same name can still be requested by other resolvers
+        set<string> external_facts;
+        if (external) {
+            fact_map_type resolved;
+            resolved.swap(_facts);
+            auto resolver_map = _resolver_map;
+
+            resolve_external(directories);
+            for (auto const& kvp : _facts) {
+                func(kvp.first, kvp.second.get());
+                external_facts.insert(kvp.first);
+            }
+
+            _facts = move(resolved);
+            _resolver_map = move(resolver_map);
+        }
+
+        // Facts with names declared by a resolver or matching a resolver's patterns (e.g. facts for each interface) may be requested
+        // by other resolvers, so retain them until all resolvers have run; everything else is released as soon as it has been written
+        set<string> retained;
+        for (auto const& kvp : _resolver_map) {
+            retained.insert(kvp.first);
+        }
+        auto resolvers = _resolvers;
+        auto retain = [&](string const& name) {
+            return retained.count(name) || any_of(resolvers.begin(), resolvers.end(), [&](shared_ptr<fact_resolver> const& resolver) {
+                return resolver->can_resolve(name);
+            });
+        };
+
+        // Start with any facts that were resolved prior to streaming
+        for (auto const& kvp : _facts) {
+            _pending.insert(kvp.first);
+        }
+
+        execution_cache::scope scope(*_execution_cache);
+        _streaming = true;
+        while (true) {
+            // Write the facts added by the last resolver
+            for (auto const& name : _pending) {
+                auto it = _facts.find(name);
+                if (it == _facts.end()) {
+                    continue;
+                }
+                if (!external_facts.count(name)) {
+                    func(name, it->second.get());
+                }
+                if (!retain(name)) {
+                    _facts.erase(it);
+                }
+            }
+            _pending.clear();
+
+            if (_resolvers.empty()) {
+                break;
+            }
+
+            // Resolving may request facts from other resolvers, which removes them from the list
+            auto resolver = _resolvers.front();
+            resolver->resolve(*this);
+            remove(resolver);
+        }
+        _streaming = false;
+
+        _resolver_map.clear();
+        _facts.clear();
+    }
+
     value const* fact_map::operator[](string const& name)
     {
         return get_value(name, true);
@@ -293,9 +745,62 @@ namespace facter { namespace facts {
 
     void fact_map::each(function<bool(string const&, value const*)> func) const
     {
-        find_if(begin(_facts), end(_facts), [&func](fact_map_type::value_type const& it) {
-            return !func(it.first, it.second.get());
-        });
+        each<function<bool(string const&, value const*)>&>(func);
+    }
+
+    sha256_digest fact_map::digest() const
+    {
+        sha256 hash;
+        hash.update("m", 1);
+        for (auto const& kvp : _facts) {
+            hash.update(static_cast<uint64_t>(kvp.first.size()));
+            hash.update(kvp.first);
+            hash.update(kvp.second->digest());
+        }
+        return hash.finish();
+    }
+
+    void fact_map::each_digest(function<bool(string const&, sha256_digest const&)> func) const
+    {
+        for (auto const& kvp : _facts) {
+            if (!func(kvp.first, kvp.second->digest())) {
+                break;
+            }
+        }
+    }
+
+    void fact_map::diff(fact_map const& previous, function<bool(string const&, value const*, value const*)> func) const
+    {
+        // Both maps are sorted by name, so walk them together
+        auto current_it = _facts.begin();
+        auto previous_it = previous._facts.begin();
+        while (current_it != _facts.end() || previous_it != previous._facts.end()) {
+            if (previous_it == previous._facts.end() || (current_it != _facts.end() && current_it->first < previous_it->first)) {
+                // Added fact
+                if (!func(current_it->first, nullptr, current_it->second.get())) {
+                    return;
+                }
+                ++current_it;
+                continue;
+            }
+            if (current_it == _facts.end() || previous_it->first < current_it->first) {
+                // Removed fact
+                if (!func(previous_it->first, previous_it->second.get(), nullptr)) {
+                    return;
+                }
+                ++previous_it;
+                continue;
+            }
+
+            // The digests are equal only if the values are structurally equal
+            if (current_it->second->digest() != previous_it->second->digest()) {
+                if (!func(current_it->first, previous_it->second.get(), current_it->second.get())) {
+                    return;
+                }
+            }
+            ++current_it;
+            ++previous_it;
+        }
     }
 
     struct stream_adapter
@@ -330,6 +835,118 @@ namespace facter { namespace facts {
         document.Accept(writer);
     }
 
+    // JSON writer that writes doubles with enough precision to be read back exactly
+    template <typename Stream>
+    struct precise_writer : Writer<Stream>
+    {
+        explicit precise_writer(Stream& stream) :
+            Writer<Stream>(stream)
+        {
+        }
+
+        precise_writer& Double(double d)
+        {
+            // JSON has no representation for NaN or infinity
+            if (!std::isfinite(d)) {
+                this->Null();
+                return *this;
+            }
+
+            this->Prefix(kNumberType);
+
+            // Use the shortest representation that converts back to the same value
+            // The classic locale is used so the decimal point does not depend on LC_NUMERIC
+            string buffer = format(d, 15);
+            if (parse(buffer) != d) {
+                buffer = format(d, 17);
+            }
+            for (auto c : buffer) {
+                this->stream_.Put(c);
+            }
+
+            // Ensure the value is still read as a double and not as an integer
+            if (buffer.find_first_of(".eE") == string::npos) {
+                this->stream_.Put('.');
+                this->stream_.Put('0');
+            }
+            return *this;
+        }
+
+     private:
+        static string format(double d, int precision)
+        {
+            ostringstream ss;
+            ss.imbue(locale::classic());
+            ss.precision(precision);
+            ss << d;
+            return ss.str();
+        }
+
+        static double parse(string const& s)
+        {
+            istringstream ss(s);
+            ss.imbue(locale::classic());
+            double d = 0;
+            ss >> d;
+            return d;
+        }
+    };
+
+    void fact_map::write_json_compact(ostream& stream, set<string> const& names) const
+    {
+        Document document;
+        document.SetObject();
+
+        for (auto const& kvp : _facts) {
+            if (!names.empty() && names.count(kvp.first) == 0) {
+                continue;
+            }
+            rapidjson::Value value;
+            kvp.second->to_json(document.GetAllocator(), value);
+            document.AddMember(kvp.first.c_str(), value, document.GetAllocator());
+        }
+
+        stream_adapter adapter(stream);
+        precise_writer<stream_adapter> writer(adapter);
+        document.Accept(writer);
+    }
+
+    void fact_map::write_json_diff(ostream& stream, fact_map const& previous) const
+    {
+        Document document;
+        document.SetObject();
+
+        diff(previous, [&](string const& name, value const* previous_value, value const* current_value) {
+            rapidjson::Value value;
+            if (current_value) {
+                current_value->to_json(document.GetAllocator(), value);
+            }
+            document.AddMember(name.c_str(), value, document.GetAllocator());
+            return true;
+        });
+
+        stream_adapter adapter(stream);
+        PrettyWriter<stream_adapter> writer(adapter);
+        writer.SetIndent(' ', 2);
+        document.Accept(writer);
+    }
+
+    void fact_map::write_yaml_diff(ostream& stream, fact_map const& previous) const
+    {
+        Emitter emitter(stream);
+        emitter << BeginMap;
+        diff(previous, [&](string const& name, value const* previous_value, value const* current_value) {
+            emitter << Key << name;
+            if (current_value) {
+                emitter << YAML::Value << *current_value;
+            } else {
+                emitter << YAML::Value << Null;
+            }
+            return true;
+        });
+        emitter << EndMap;
+    }
+
     void fact_map::write_yaml(ostream& stream) const
     {
         Emitter emitter(stream);
@@ -341,11 +958,35 @@ namespace facter { namespace facts {
         emitter << EndMap;
     }
 
+    void fact_map::write_json_line(ostream& stream, string const& name, value const* val)
+    {
+        if (!val) {
+            return;
+        }
+
+        Document document;
+        document.SetObject();
+
+        rapidjson::Value value;
+        val->to_json(document.GetAllocator(), value);
+        document.AddMember(name.c_str(), value, document.GetAllocator());
+
+        stream_adapter adapter(stream);
+        Writer<stream_adapter> writer(adapter);
+        document.Accept(writer);
+        stream << '\n';
+    }
+
     value const* fact_map::get_value(string const& name, bool resolve)
     {
         // Lookup the fact
         auto it = _facts.find(name);
         while (it == _facts.end()) {
+            // A map used for concurrent resolution or refresh gets facts it does not have from the delegate
+            if (_delegate) {
+                return _delegate->get(name, resolve);
+            }
+
             // Look for a resolver for this fact
             auto resolver = resolve ? find_resolver(name) : nullptr;
             if (!resolver) {
@@ -353,7 +994,10 @@ namespace facter { namespace facts {
             }
 
             // Resolve the facts
-            resolver->resolve(*this);
+            {
+                execution_cache::scope scope(*_execution_cache);
+                resolver->resolve(*this);
+            }
             remove(resolver);
 
             // Try to find the fact again
@@ -362,6 +1006,35 @@ namespace facter { namespace facts {
         return it->second.get();
     }
 
+    void fact_map::merge(fact_map& other, vector<shared_ptr<fact_resolver>> const& resolvers)
+    {
+        // Only facts of the given resolvers are taken from the other map; external facts are never replaced
+        auto owned = [&](string const& name) {
+            if (_external.count(name)) {
+                return false;
+            }
+            return any_of(resolvers.begin(), resolvers.end(), [&](shared_ptr<fact_resolver> const& resolver) {
+                return is_responsible(*resolver, name);
+            });
+        };
+
+        // Remove facts that no longer resolve (for example, facts for a removed network interface)
+        for (auto it = _facts.begin(); it != _facts.end();) {
+            if (owned(it->first) && other._facts.count(it->first) == 0) {
+                LOG_DEBUG("fact \"%1%\" no longer resolves and will be removed.", it->first);
+                it = _facts.erase(it);
+                continue;
+            }
+            ++it;
+        }
+
+        for (auto& kvp : other._facts) {
+            if (owned(kvp.first)) {
+                _facts[kvp.first] = move(kvp.second);
+            }
+        }
+    }
+
     shared_ptr<fact_resolver> fact_map::find_resolver(string const& name)
     {
         // Check the map first to see if we know the fact by name
@@ -29,45 +29,68 @@ namespace facter { namespace facts { namespace linux {
 
     void lsb_resolver::resolve_facts(fact_map& facts)
     {
+        // Query everything with a single lsb_release call rather than one call per fact
+        string dist_id;
+        string dist_release;
+        string dist_codename;
+        string dist_description;
+        string release;
+        each_line("lsb_release", { "-a" }, [&](string& line) {
+            auto pos = line.find(':');
+            if (pos == string::npos) {
+                return true;
+            }
+            auto key = line.substr(0, pos);
+            auto value = trim(line.substr(pos + 1));
+            if (key == "Distributor ID") {
+                dist_id = move(value);
+            } else if (key == "Release") {
+                dist_release = move(value);
+            } else if (key == "Codename") {
+                dist_codename = move(value);
+            } else if (key == "Description") {
+                dist_description = move(value);
+            } else if (key == "LSB Version") {
+                release = move(value);
+            }
+            return true;
+        });
+
         // Resolve all lsb-related facts
-        resolve_dist_id(facts);
-        resolve_dist_release(facts);
-        resolve_dist_codename(facts);
-        resolve_dist_description(facts);
+        resolve_dist_id(facts, move(dist_id));
+        resolve_dist_release(facts, move(dist_release));
+        resolve_dist_codename(facts, move(dist_codename));
+        resolve_dist_description(facts, move(dist_description));
         resolve_dist_version(facts);
-        resolve_release(facts);
+        resolve_release(facts, move(release));
     }
 
-    void lsb_resolver::resolve_dist_id(fact_map& facts)
+    void lsb_resolver::resolve_dist_id(fact_map& facts, string value)
     {
-        string value = execute("lsb_release", {"-i", "-s"});
         if (value.empty()) {
             return;
         }
         facts.add(fact::lsb_dist_id, make_value<string_value>(move(value)));
     }
 
-    void lsb_resolver::resolve_dist_release(fact_map& facts)
+    void lsb_resolver::resolve_dist_release(fact_map& facts, string value)
     {
-        string value = execute("lsb_release", {"-r", "-s"});
         if (value.empty()) {
             return;
         }
         facts.add(fact::lsb_dist_release, make_value<string_value>(move(value)));
     }
 
-    void lsb_resolver::resolve_dist_codename(fact_map& facts)
+    void lsb_resolver::resolve_dist_codename(fact_map& facts, string value)
     {
-        string value = execute("lsb_release", {"-c", "-s"});
         if (value.empty()) {
             return;
         }
         facts.add(fact::lsb_dist_codename, make_value<string_value>(move(value)));
     }
 
-    void lsb_resolver::resolve_dist_description(fact_map& facts)
+    void lsb_resolver::resolve_dist_description(fact_map& facts, string value)
     {
-        string value = execute("lsb_release", {"-d", "-s"});
         if (value.empty()) {
             return;
         }
@@ -76,6 +99,16 @@ namespace facter { namespace facts { namespace linux {
         facts.add(fact::lsb_dist_description, make_value<string_value>(trim(move(value), { '\"' })));
     }
 
+    static unique_ptr<value> make_release_value(string&& release)
+    {
+        // Releases like "04" or "testing" cannot be represented as integers, so they remain strings
+        int64_t number;
+        if (to_integer(release, number)) {
+            return make_value<integer_value>(number);
+        }
+        return make_value<string_value>(move(release));
+    }
+
     void lsb_resolver::resolve_dist_version(fact_map& facts)
     {
         auto dist_release = facts.get<string_value>(fact::lsb_dist_release, false);
@@ -87,16 +120,15 @@ namespace facter { namespace facts { namespace linux {
         if (!RE2::PartialMatch(dist_release->value(), "(\\d+)\\.(\\d*)", &major, &minor)) {
             major = dist_release->value();
         }
-        facts.add(fact::lsb_dist_major_release, make_value<string_value>(move(major)));
+        facts.add(fact::lsb_dist_major_release, make_release_value(move(major)));
 
         if (!minor.empty()) {
-            facts.add(fact::lsb_dist_minor_release, make_value<string_value>(move(minor)));
+            facts.add(fact::lsb_dist_minor_release, make_release_value(move(minor)));
         }
     }
 
-    void lsb_resolver::resolve_release(fact_map& facts)
+    void lsb_resolver::resolve_release(fact_map& facts, string value)
     {
-        string value = execute("lsb_release", {"-v", "-s"});
         if (value.empty()) {
             return;
         }
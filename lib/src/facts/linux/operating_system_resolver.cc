@@ -171,7 +171,7 @@ namespace facter { namespace facts { namespace linux {
 
         // For VMware ESX, execute the vmware tool
         if (value.empty() && operating_system->value() == os::vmware_esx) {
-            string output = execute("vmware", { "-v" });
+            string output = execute("vmware", { "-v" }, option_set<execution_options>({ execution_options::defaults, execution_options::cache_output }));
             RE2::PartialMatch(output, "VMware ESX .*?(\\d.*)", &value);
         }
 
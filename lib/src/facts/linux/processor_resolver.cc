@@ -116,10 +116,10 @@ namespace facter { namespace facts { namespace linux {
 
         // Add the count facts
         if (logical_count > 0) {
-            facts.add(fact::processor_count, make_value<string_value>(to_string(logical_count)));
+            facts.add(fact::processor_count, make_value<integer_value>(static_cast<int64_t>(logical_count)));
         }
         if (physical_count > 0) {
-            facts.add(fact::physical_processor_count, make_value<string_value>(to_string(physical_count)));
+            facts.add(fact::physical_processor_count, make_value<integer_value>(static_cast<int64_t>(physical_count)));
         }
     }
 
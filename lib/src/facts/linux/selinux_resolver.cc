@@ -3,6 +3,7 @@
 #include <facter/facts/fact.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <facter/util/file.hpp>
+#include <facter/util/string.hpp>
 #include <re2/re2.h>
 
 using namespace std;
@@ -64,12 +65,17 @@ namespace facter { namespace facts { namespace linux {
     void selinux_resolver::resolve_selinux_policyvers(fact_map& facts, string const& mount)
     {
         string path = mount + "/policyvers";
-        string buffer = file::read(path);
+        string buffer = trim(file::read(path));
 
         if (buffer.empty()) {
             return;
         }
 
+        int64_t version;
+        if (to_integer(buffer, version)) {
+            facts.add(fact::selinux_policyversion, make_value<integer_value>(version));
+            return;
+        }
         facts.add(fact::selinux_policyversion, make_value<string_value>(move(buffer)));
     }
 
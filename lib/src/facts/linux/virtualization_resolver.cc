@@ -153,7 +153,8 @@ namespace facter { namespace facts { namespace linux {
 
     string virtualization_resolver::get_vmware_vm()
     {
-        auto parts = split(execute("vmware -v"));
+        // The output is shared with the operating system resolver for VMware ESX
+        auto parts = split(execute("vmware", { "-v" }, option_set<execution_options>({ execution_options::defaults, execution_options::cache_output })));
         if (parts.size() < 2) {
             return {};
         }
@@ -4,8 +4,10 @@
 #include <facter/facterlib.h>
 #include <rapidjson/document.h>
 #include <yaml-cpp/yaml.h>
+#include <algorithm>
 
 using namespace std;
+using namespace facter::util;
 using namespace rapidjson;
 using namespace YAML;
 
@@ -13,6 +15,10 @@ LOG_DECLARE_NAMESPACE("facts.value.map");
 
 namespace facter { namespace facts {
 
+    map_value::map_value()
+    {
+    }
+
     void map_value::add(string&& name, unique_ptr<value>&& value)
     {
         if (!value) {
@@ -20,7 +26,23 @@ namespace facter { namespace facts {
             return;
         }
 
-        _elements.emplace(move(name), move(value));
+        // Elements are usually added in order, so check the end before searching
+        if (_elements.empty() || _elements.back().first < name) {
+            _elements.emplace_back(move(name), move(value));
+            return;
+        }
+        auto it = lower_bound(_elements.begin(), _elements.end(), name, [](pair<string, unique_ptr<struct value>> const& element, string const& name) {
+            return element.first < name;
+        });
+        if (it != _elements.end() && it->first == name) {
+            return;
+        }
+        _elements.emplace(it, move(name), move(value));
+    }
+
+    void map_value::reserve(size_t size)
+    {
+        _elements.reserve(size);
     }
 
     bool map_value::empty() const
@@ -35,17 +57,25 @@ namespace facter { namespace facts {
 
     void map_value::each(function<bool(string const&, value const*)> func) const
     {
-        for (auto const& kvp : _elements) {
-            if (!func(kvp.first, kvp.second.get())) {
-                break;
-            }
-        }
+        each<function<bool(string const&, value const*)>&>(func);
+    }
+
+    value_kind map_value::kind() const
+    {
+        return value_kind::map;
+    }
+
+    void map_value::accept(value_visitor& visitor) const
+    {
+        visitor.visit(*this);
     }
 
     value const* map_value::operator[](string const& name) const
     {
-        auto it = _elements.find(name);
-        if (it == _elements.end()) {
+        auto it = lower_bound(_elements.begin(), _elements.end(), name, [](pair<string, unique_ptr<value>> const& element, string const& name) {
+            return element.first < name;
+        });
+        if (it == _elements.end() || it->first != name) {
             return nullptr;
         }
         return it->second.get();
@@ -82,6 +112,19 @@ namespace facter { namespace facts {
         }
     }
 
+    sha256_digest map_value::digest() const
+    {
+        // The elements are sorted by name, so the digest does not depend on insertion order
+        sha256 hash;
+        hash.update("m", 1);
+        for (auto const& kvp : _elements) {
+            hash.update(static_cast<uint64_t>(kvp.first.size()));
+            hash.update(kvp.first);
+            hash.update(kvp.second->digest());
+        }
+        return hash.finish();
+    }
+
     ostream& map_value::write(ostream& os) const
     {
         // Write out the elements in the map
@@ -94,7 +137,7 @@ namespace facter { namespace facts {
                 os << ", ";
             }
             os << '"' << kvp.first << "\"=>";
-            bool quote = dynamic_cast<string_value const*>(kvp.second.get());
+            bool quote = kvp.second->kind() == value_kind::string;
             if (quote) {
                 os << '"';
             }
@@ -75,10 +75,23 @@ namespace facter { namespace facts { namespace osx {
         return map<string, string>();
     }
 
-    string networking_resolver::find_dhcp_server(string const& interface)
+    map<string, string> networking_resolver::query_dhcp_servers(vector<string> const& interfaces)
     {
-        // Use ipconfig to get the server identifier
-        return execute("ipconfig", { "getoption", interface, "server_identifier" });
+        // Use ipconfig to get the server identifiers
+        vector<command> commands;
+        commands.reserve(interfaces.size());
+        for (auto const& interface : interfaces) {
+            commands.emplace_back("ipconfig", vector<string>{ "getoption", interface, "server_identifier" });
+        }
+        auto outputs = execute_many(commands);
+
+        map<string, string> servers;
+        for (size_t i = 0; i < interfaces.size(); ++i) {
+            if (!outputs[i].empty()) {
+                servers.emplace(interfaces[i], move(outputs[i]));
+            }
+        }
+        return servers;
     }
 
 }}}  // namespace facter::facts::osx
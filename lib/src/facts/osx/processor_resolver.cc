@@ -22,7 +22,7 @@ namespace facter { namespace facts { namespace osx {
         if (sysctlbyname("hw.logicalcpu_max", &logical_count, &size, nullptr, 0) != 0) {
             LOG_DEBUG("sysctlbyname failed: %1% (%2%): %3% fact is unavailable.", strerror(errno), errno, fact::processor_count);
         } else {
-            facts.add(fact::processor_count, make_value<string_value>(to_string(logical_count)));
+            facts.add(fact::processor_count, make_value<integer_value>(static_cast<int64_t>(logical_count)));
         }
 
         // Get the physical count of processors
@@ -31,7 +31,7 @@ namespace facter { namespace facts { namespace osx {
         if (sysctlbyname("hw.physicalcpu_max", &physical_count, &size, nullptr, 0) != 0) {
             LOG_DEBUG("sysctlbyname failed: %1% (%2%): %3% fact is unavailable.", strerror(errno), errno, fact::physical_processor_count);
         } else {
-            facts.add(fact::physical_processor_count, make_value<string_value>(to_string(physical_count)));
+            facts.add(fact::physical_processor_count, make_value<integer_value>(static_cast<int64_t>(physical_count)));
         }
 
         // For each logical processor, output a fact with the model name
@@ -0,0 +1,60 @@
+#include <facter/facts/snapshot.hpp>
+#include <facter/logging/logging.hpp>
+#include <facter/util/posix/scoped_descriptor.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cstring>
+#include <cerrno>
+
+using namespace std;
+using namespace facter::util::posix;
+
+LOG_DECLARE_NAMESPACE("facts.snapshot");
+
+namespace facter { namespace facts {
+
+    snapshot::snapshot(string const& path) :
+        _data(nullptr),
+        _size(0)
+    {
+        scoped_descriptor descriptor(open(path.c_str(), O_RDONLY));
+        if (static_cast<int>(descriptor) < 0) {
+            throw snapshot_exception("snapshot \"" + path + "\" could not be opened: " + strerror(errno) + ".");
+        }
+
+        struct stat info;
+        if (fstat(descriptor, &info) != 0) {
+            throw snapshot_exception("snapshot \"" + path + "\" could not be read: " + strerror(errno) + ".");
+        }
+        _size = static_cast<size_t>(info.st_size);
+
+        // The mapping remains valid after the descriptor is closed
+        if (_size > 0) {
+            void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (data == MAP_FAILED) {
+                throw snapshot_exception("snapshot \"" + path + "\" could not be mapped: " + strerror(errno) + ".");
+            }
+            _data = static_cast<uint8_t const*>(data);
+        }
+
+        try {
+            validate();
+        } catch (snapshot_exception&) {
+            if (_data) {
+                munmap(const_cast<uint8_t*>(_data), _size);
+            }
+            throw;
+        }
+
+        LOG_DEBUG("mapped snapshot \"%1%\" containing %2% facts.", path, size());
+    }
+
+    snapshot::~snapshot()
+    {
+        if (_data) {
+            munmap(const_cast<uint8_t*>(_data), _size);
+        }
+    }
+
+}}  // namespace facter::facts
@@ -3,17 +3,67 @@
 #include <rapidjson/document.h>
 #include <yaml-cpp/yaml.h>
 #include <iomanip>
+#include <cstring>
 
 using namespace std;
+using namespace facter::util;
 using namespace rapidjson;
 using namespace YAML;
 
 namespace facter { namespace facts {
 
-    template <>
+    // Shared by empty and moved-from string values so that they never hold a null string
+    static shared_ptr<string const> const& empty_string()
+    {
+        static shared_ptr<string const> const empty = make_shared<string const>();
+        return empty;
+    }
+
+    scalar_value<string>::scalar_value(string&& value) :
+        _value(make_shared<string const>(move(value)))
+    {
+    }
+
+    scalar_value<string>::scalar_value(string const& value) :
+        _value(make_shared<string const>(value))
+    {
+    }
+
+    scalar_value<string>::scalar_value(shared_ptr<string const> value) :
+        _value(value ? move(value) : empty_string())
+    {
+    }
+
+    scalar_value<string>::scalar_value(scalar_value&& other) :
+        facts::value(move(other)),
+        _value(move(other._value))
+    {
+        other._value = empty_string();
+    }
+
+    scalar_value<string>& scalar_value<string>::operator=(scalar_value&& other)
+    {
+        if (this != &other) {
+            facts::value::operator=(move(other));
+            _value = move(other._value);
+            other._value = empty_string();
+        }
+        return *this;
+    }
+
+    value_kind scalar_value<string>::kind() const
+    {
+        return value_kind::string;
+    }
+
+    void scalar_value<string>::accept(value_visitor& visitor) const
+    {
+        visitor.visit(*this);
+    }
+
     void scalar_value<string>::to_json(Allocator& allocator, rapidjson::Value& value) const
     {
-        value.SetString(_value.c_str(), _value.size());
+        value.SetString(_value->c_str(), _value->size());
     }
 
     template <>
@@ -34,11 +84,10 @@ namespace facter { namespace facts {
         value.SetDouble(_value);
     }
 
-    template <>
     void scalar_value<string>::notify(string const& name, enumeration_callbacks const* callbacks) const
     {
         if (callbacks && callbacks->string) {
-            callbacks->string(name.c_str(), _value.c_str());
+            callbacks->string(name.c_str(), _value->c_str());
         }
     }
 
@@ -66,14 +115,58 @@ namespace facter { namespace facts {
         }
     }
 
+    // Each scalar digest starts with a type tag so values of different types never share a digest
+    sha256_digest scalar_value<string>::digest() const
+    {
+        sha256 hash;
+        hash.update("s", 1);
+        hash.update(*_value);
+        return hash.finish();
+    }
+
+    template <>
+    sha256_digest scalar_value<int64_t>::digest() const
+    {
+        sha256 hash;
+        hash.update("i", 1);
+        hash.update(static_cast<uint64_t>(_value));
+        return hash.finish();
+    }
+
     template <>
+    sha256_digest scalar_value<bool>::digest() const
+    {
+        sha256 hash;
+        hash.update(_value ? "bt" : "bf", 2);
+        return hash.finish();
+    }
+
+    template <>
+    sha256_digest scalar_value<double>::digest() const
+    {
+        uint64_t bits;
+        static_assert(sizeof(bits) == sizeof(_value), "expected a 64-bit double.");
+        memcpy(&bits, &_value, sizeof(bits));
+
+        sha256 hash;
+        hash.update("d", 1);
+        hash.update(bits);
+        return hash.finish();
+    }
+
+    ostream& scalar_value<string>::write(ostream& os) const
+    {
+        os << *_value;
+        return os;
+    }
+
     Emitter& scalar_value<string>::write(Emitter& emitter) const
     {
         // Unfortunately, yaml-cpp doesn't handle quoting strings automatically that well
         // For instance, if the string is an integer, no quotes are written out
         // This will cause someone parsing the YAML to see the type as an integer and
         // not as a string.
-        emitter << DoubleQuoted << _value;
+        emitter << DoubleQuoted << *_value;
         return emitter;
     }
 
@@ -84,7 +177,6 @@ namespace facter { namespace facts {
         return os;
     }
 
-    template struct scalar_value<string>;
     template struct scalar_value<int64_t>;
     template struct scalar_value<bool>;
     template struct scalar_value<double>;
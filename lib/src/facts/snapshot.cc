@@ -0,0 +1,404 @@
+#include <facter/facts/snapshot.hpp>
+#include <facter/facts/fact_map.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/logging/logging.hpp>
+#include <facter/util/file.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+using namespace std;
+using namespace facter::util;
+
+LOG_DECLARE_NAMESPACE("facts.snapshot");
+
+namespace facter { namespace facts {
+
+    // The snapshot layout is:
+    //   header
+    //   fact index: an entry for each fact, sorted by name
+    //   map entries, array nodes, and strings referenced by offset from the file's start
+    // Strings are stored as a 32-bit length followed by the characters and a null terminator.
+    static const char snapshot_magic[4] = { 'C', 'F', 'S', 'N' };
+    static const uint32_t snapshot_byte_order = 0x01020304;
+    static const uint32_t snapshot_version = 1;
+
+    // Limits the nesting of values so a corrupt snapshot cannot cause unbounded recursion
+    static const int snapshot_max_depth = 256;
+
+    enum class snapshot_type : uint8_t
+    {
+        string = 1,
+        integer = 2,
+        boolean = 3,
+        dbl = 4,
+        array = 5,
+        map = 6
+    };
+
+    struct snapshot_header
+    {
+        char magic[4];
+        uint32_t byte_order;
+        uint32_t version;
+        uint32_t count;
+        uint64_t index;
+        uint64_t size;
+    };
+
+    struct snapshot_node
+    {
+        // The type of the node
+        uint8_t type;
+        uint8_t reserved[3];
+        // The number of elements for arrays and maps
+        uint32_t count;
+        // The string offset for strings, the value for scalars, or the elements offset for arrays and maps
+        uint64_t data;
+    };
+
+    struct snapshot_entry
+    {
+        uint64_t name;
+        snapshot_node value;
+    };
+
+    static_assert(sizeof(snapshot_header) == 32, "unexpected snapshot header size.");
+    static_assert(sizeof(snapshot_node) == 16, "unexpected snapshot node size.");
+    static_assert(sizeof(snapshot_entry) == 24, "unexpected snapshot entry size.");
+
+    snapshot_exception::snapshot_exception(string const& message) :
+        runtime_error(message)
+    {
+    }
+
+    static void check_range(size_t size, uint64_t offset, uint64_t length)
+    {
+        if (offset > size || length > size - offset) {
+            throw snapshot_exception("snapshot is corrupt: offset is out of range.");
+        }
+    }
+
+    template <typename T>
+    static T read_at(uint8_t const* data, size_t size, uint64_t offset)
+    {
+        check_range(size, offset, sizeof(T));
+        T result;
+        memcpy(&result, data + offset, sizeof(T));
+        return result;
+    }
+
+    static char const* read_string(uint8_t const* data, size_t size, uint64_t offset, uint32_t& length)
+    {
+        length = read_at<uint32_t>(data, size, offset);
+        check_range(size, offset + sizeof(uint32_t), static_cast<uint64_t>(length) + 1);
+        auto str = reinterpret_cast<char const*>(data + offset + sizeof(uint32_t));
+        if (str[length] != '\0') {
+            throw snapshot_exception("snapshot is corrupt: string is not terminated.");
+        }
+        return str;
+    }
+
+    static unique_ptr<value> to_value(uint8_t const* data, size_t size, snapshot_node const& node, int depth)
+    {
+        if (depth > snapshot_max_depth) {
+            throw snapshot_exception("snapshot is corrupt: values are nested too deeply.");
+        }
+
+        switch (static_cast<snapshot_type>(node.type)) {
+            case snapshot_type::string: {
+                uint32_t length;
+                auto str = read_string(data, size, node.data, length);
+                return make_value<string_value>(string(str, length));
+            }
+            case snapshot_type::integer:
+                return make_value<integer_value>(static_cast<int64_t>(node.data));
+            case snapshot_type::boolean:
+                return make_value<boolean_value>(node.data != 0);
+            case snapshot_type::dbl: {
+                double d;
+                memcpy(&d, &node.data, sizeof(d));
+                return make_value<double_value>(d);
+            }
+            case snapshot_type::array: {
+                check_range(size, node.data, static_cast<uint64_t>(node.count) * sizeof(snapshot_node));
+                auto array = make_value<array_value>();
+                for (uint32_t i = 0; i < node.count; ++i) {
+                    auto child = read_at<snapshot_node>(data, size, node.data + i * sizeof(snapshot_node));
+                    array->add(to_value(data, size, child, depth + 1));
+                }
+                return unique_ptr<value>(move(array));
+            }
+            case snapshot_type::map: {
+                check_range(size, node.data, static_cast<uint64_t>(node.count) * sizeof(snapshot_entry));
+                auto map = make_value<map_value>();
+                map->reserve(node.count);
+                for (uint32_t i = 0; i < node.count; ++i) {
+                    auto entry = read_at<snapshot_entry>(data, size, node.data + i * sizeof(snapshot_entry));
+                    uint32_t length;
+                    auto name = read_string(data, size, entry.name, length);
+                    map->add(string(name, length), to_value(data, size, entry.value, depth + 1));
+                }
+                return unique_ptr<value>(move(map));
+            }
+        }
+        throw snapshot_exception("snapshot is corrupt: unknown value type.");
+    }
+
+    size_t snapshot::size() const
+    {
+        return read_at<snapshot_header>(_data, _size, 0).count;
+    }
+
+    unique_ptr<value> snapshot::get(string const& name) const
+    {
+        uint64_t offset;
+        if (!find(name, offset)) {
+            return nullptr;
+        }
+        auto entry = read_at<snapshot_entry>(_data, _size, offset);
+        return to_value(_data, _size, entry.value, 0);
+    }
+
+    void snapshot::populate(fact_map& facts, set<string> const& names) const
+    {
+        if (!names.empty()) {
+            for (auto const& name : names) {
+                auto value = get(name);
+                if (value) {
+                    facts.add(string(name), move(value));
+                }
+            }
+            return;
+        }
+
+        auto header = read_at<snapshot_header>(_data, _size, 0);
+        for (uint32_t i = 0; i < header.count; ++i) {
+            auto entry = read_at<snapshot_entry>(_data, _size, header.index + i * sizeof(snapshot_entry));
+            uint32_t length;
+            auto name = read_string(_data, _size, entry.name, length);
+            facts.add(string(name, length), to_value(_data, _size, entry.value, 0));
+        }
+    }
+
+    void snapshot::validate() const
+    {
+        if (_size < sizeof(snapshot_header)) {
+            throw snapshot_exception("file is not a fact snapshot.");
+        }
+        auto header = read_at<snapshot_header>(_data, _size, 0);
+        if (memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+            throw snapshot_exception("file is not a fact snapshot.");
+        }
+        if (header.byte_order != snapshot_byte_order) {
+            throw snapshot_exception("snapshot was written on a platform with a different byte order.");
+        }
+        if (header.version != snapshot_version) {
+            throw snapshot_exception("snapshot version " + to_string(header.version) + " is not supported.");
+        }
+        if (header.size != _size) {
+            throw snapshot_exception("snapshot is corrupt: unexpected file size.");
+        }
+        check_range(_size, header.index, static_cast<uint64_t>(header.count) * sizeof(snapshot_entry));
+    }
+
+    bool snapshot::find(string const& name, uint64_t& offset) const
+    {
+        auto header = read_at<snapshot_header>(_data, _size, 0);
+
+        // The index is sorted by name, so do a binary search without copying any names
+        uint32_t low = 0;
+        uint32_t high = header.count;
+        while (low < high) {
+            uint32_t middle = low + (high - low) / 2;
+            uint64_t current = header.index + middle * sizeof(snapshot_entry);
+            auto entry = read_at<snapshot_entry>(_data, _size, current);
+
+            uint32_t length;
+            auto entry_name = read_string(_data, _size, entry.name, length);
+            int result = memcmp(entry_name, name.c_str(), min<size_t>(length, name.size()));
+            if (result == 0) {
+                result = length < name.size() ? -1 : (length > name.size() ? 1 : 0);
+            }
+            if (result == 0) {
+                offset = current;
+                return true;
+            }
+            if (result < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return false;
+    }
+
+    // Helper for building a snapshot in memory
+    struct snapshot_writer
+    {
+        vector<uint8_t> const& data() const
+        {
+            return _buffer;
+        }
+
+        uint64_t allocate(size_t size)
+        {
+            // Keep nodes aligned to 8 bytes so they can be read in place
+            align(8);
+            uint64_t offset = _buffer.size();
+            _buffer.resize(_buffer.size() + size);
+            return offset;
+        }
+
+        template <typename T>
+        void write_at(uint64_t offset, T const& data)
+        {
+            memcpy(_buffer.data() + offset, &data, sizeof(T));
+        }
+
+        uint64_t add_string(string const& str)
+        {
+            // Identical strings, like repeated keys, are only stored once
+            auto it = _strings.find(str);
+            if (it != _strings.end()) {
+                return it->second;
+            }
+
+            align(4);
+            uint64_t offset = _buffer.size();
+            uint32_t length = static_cast<uint32_t>(str.size());
+            _buffer.resize(_buffer.size() + sizeof(length) + str.size() + 1);
+            memcpy(_buffer.data() + offset, &length, sizeof(length));
+            memcpy(_buffer.data() + offset + sizeof(length), str.c_str(), str.size() + 1);
+            _strings.emplace(str, offset);
+            return offset;
+        }
+
+        void write_node(uint64_t offset, value const* val)
+        {
+            snapshot_node node = {};
+            node_visitor visitor(*this, node);
+            val->accept(visitor);
+            write_at(offset, node);
+        }
+
+        void write_entry(uint64_t offset, string const& name, value const* val)
+        {
+            uint64_t name_offset = add_string(name);
+            write_at(offset, name_offset);
+            write_node(offset + offsetof(snapshot_entry, value), val);
+        }
+
+     private:
+        // Fills in a node based on the type of value
+        struct node_visitor : value_visitor
+        {
+            node_visitor(snapshot_writer& writer, snapshot_node& node) :
+                _writer(writer),
+                _node(node)
+            {
+            }
+
+            virtual void visit(string_value const& val)
+            {
+                _node.type = static_cast<uint8_t>(snapshot_type::string);
+                _node.data = _writer.add_string(val.value());
+            }
+
+            virtual void visit(integer_value const& val)
+            {
+                _node.type = static_cast<uint8_t>(snapshot_type::integer);
+                _node.data = static_cast<uint64_t>(val.value());
+            }
+
+            virtual void visit(boolean_value const& val)
+            {
+                _node.type = static_cast<uint8_t>(snapshot_type::boolean);
+                _node.data = val.value() ? 1 : 0;
+            }
+
+            virtual void visit(double_value const& val)
+            {
+                _node.type = static_cast<uint8_t>(snapshot_type::dbl);
+                double d = val.value();
+                memcpy(&_node.data, &d, sizeof(d));
+            }
+
+            virtual void visit(array_value const& val)
+            {
+                _node.type = static_cast<uint8_t>(snapshot_type::array);
+                _node.count = static_cast<uint32_t>(val.size());
+                _node.data = _writer.allocate(val.size() * sizeof(snapshot_node));
+                uint64_t current = _node.data;
+                for (auto element : val) {
+                    _writer.write_node(current, element);
+                    current += sizeof(snapshot_node);
+                }
+            }
+
+            virtual void visit(map_value const& val)
+            {
+                _node.type = static_cast<uint8_t>(snapshot_type::map);
+                _node.count = static_cast<uint32_t>(val.size());
+                _node.data = _writer.allocate(val.size() * sizeof(snapshot_entry));
+                uint64_t current = _node.data;
+                for (auto const& kvp : val) {
+                    _writer.write_entry(current, kvp.first, kvp.second);
+                    current += sizeof(snapshot_entry);
+                }
+            }
+
+         private:
+            snapshot_writer& _writer;
+            snapshot_node& _node;
+        };
+
+        void align(size_t alignment)
+        {
+            _buffer.resize((_buffer.size() + alignment - 1) / alignment * alignment);
+        }
+
+        vector<uint8_t> _buffer;
+        map<string, uint64_t> _strings;
+    };
+
+    void snapshot::write(string const& path, fact_map const& facts)
+    {
+        LOG_DEBUG("writing fact snapshot to \"%1%\".", path);
+
+        snapshot_writer writer;
+        auto header_offset = writer.allocate(sizeof(snapshot_header));
+
+        snapshot_header header = {};
+        memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+        header.byte_order = snapshot_byte_order;
+        header.version = snapshot_version;
+        header.count = static_cast<uint32_t>(facts.size());
+        header.index = writer.allocate(facts.size() * sizeof(snapshot_entry));
+
+        // The fact map is sorted by name, so the index is too
+        uint64_t current = header.index;
+        facts.each([&](string const& name, value const* val) {
+            writer.write_entry(current, name, val);
+            current += sizeof(snapshot_entry);
+            return true;
+        });
+
+        header.size = writer.data().size();
+        writer.write_at(header_offset, header);
+
+        auto const& data = writer.data();
+        if (!file::atomic_write(path, [&](ostream& stream) {
+                stream.write(reinterpret_cast<char const*>(data.data()), data.size());
+            })) {
+            throw snapshot_exception("snapshot could not be written to \"" + path + "\".");
+        }
+
+        LOG_DEBUG("wrote %1% facts to snapshot \"%2%\".", header.count, path);
+    }
+
+}}  // namespace facter::facts
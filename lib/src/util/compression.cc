@@ -0,0 +1,116 @@
+#include <facter/util/compression.hpp>
+#include <zlib.h>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    // Adding 16 to the window bits tells zlib to write a gzip header and trailer
+    static const int gzip_window_bits = 15 + 16;
+    static const int default_memory_level = 8;
+    static const size_t buffer_size = 16 * 1024;
+
+    compression_exception::compression_exception(string const& message) :
+        runtime_error(message)
+    {
+    }
+
+    gzip_streambuf::gzip_streambuf(ostream& stream, int level) :
+        _stream(stream),
+        _zstream(new z_stream()),
+        _input(buffer_size),
+        _output(buffer_size),
+        _finished(false)
+    {
+        if (deflateInit2(_zstream.get(), level, Z_DEFLATED, gzip_window_bits, default_memory_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw compression_exception("failed to initialize gzip compression.");
+        }
+        setp(_input.data(), _input.data() + _input.size());
+    }
+
+    gzip_streambuf::~gzip_streambuf()
+    {
+        try {
+            finish();
+        } catch (compression_exception&) {
+            // Destructors cannot throw
+        }
+        deflateEnd(_zstream.get());
+    }
+
+    void gzip_streambuf::finish()
+    {
+        if (_finished) {
+            return;
+        }
+        _finished = true;
+        if (!deflate_input(Z_FINISH)) {
+            throw compression_exception("failed to finish gzip compression.");
+        }
+        _stream.flush();
+    }
+
+    gzip_streambuf::int_type gzip_streambuf::overflow(int_type ch)
+    {
+        if (_finished || !deflate_input(Z_NO_FLUSH)) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int gzip_streambuf::sync()
+    {
+        // A sync flush lets a reader decompress everything written so far
+        if (_finished || !deflate_input(Z_SYNC_FLUSH)) {
+            return -1;
+        }
+        _stream.flush();
+        return _stream ? 0 : -1;
+    }
+
+    bool gzip_streambuf::deflate_input(int flush)
+    {
+        _zstream->next_in = reinterpret_cast<Bytef*>(pbase());
+        _zstream->avail_in = static_cast<uInt>(pptr() - pbase());
+
+        // Deflate until zlib has consumed all of the input and has no more pending output
+        int result;
+        do {
+            _zstream->next_out = reinterpret_cast<Bytef*>(_output.data());
+            _zstream->avail_out = static_cast<uInt>(_output.size());
+
+            result = deflate(_zstream.get(), flush);
+            if (result == Z_STREAM_ERROR) {
+                return false;
+            }
+
+            auto size = _output.size() - _zstream->avail_out;
+            if (size > 0 && !_stream.write(_output.data(), size)) {
+                return false;
+            }
+        } while (_zstream->avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+
+        // The put area is now empty
+        setp(_input.data(), _input.data() + _input.size());
+        return true;
+    }
+
+    gzip_ostream::gzip_ostream(ostream& stream, int level) :
+        ostream(nullptr),
+        _buffer(stream, level)
+    {
+        // The buffer is constructed after the stream base, so it can only be attached once constructed
+        init(&_buffer);
+    }
+
+    void gzip_ostream::finish()
+    {
+        flush();
+        _buffer.finish();
+    }
+
+}}  // namespace facter::util
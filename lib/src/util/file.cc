@@ -1,6 +1,8 @@
 #include <facter/util/file.hpp>
 #include <sstream>
 #include <fstream>
+#include <cstdio>
+#include <unistd.h>
 
 using namespace std;
 
@@ -58,4 +60,30 @@ namespace facter { namespace util { namespace file {
         return static_cast<bool>(getline(in, line));
     }
 
+    bool atomic_write(string const& path, function<void(ostream&)> writer)
+    {
+        // Write to a temporary file that is unique to this process
+        string temp_path = path + ".tmp" + to_string(getpid());
+        {
+            ofstream out(temp_path, ios::out | ios::binary | ios::trunc);
+            if (!out) {
+                return false;
+            }
+            writer(out);
+            out.flush();
+            if (!out) {
+                out.close();
+                remove(temp_path.c_str());
+                return false;
+            }
+        }
+
+        // Renaming is atomic, so readers see either the old file or the new file
+        if (rename(temp_path.c_str(), path.c_str()) != 0) {
+            remove(temp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
 }}}  // namespace facter::util::file
@@ -0,0 +1,71 @@
+#include <facter/util/sha256.hpp>
+#include <openssl/evp.h>
+#include <stdexcept>
+
+using namespace std;
+
+namespace facter { namespace util {
+
+    struct sha256::context
+    {
+        context() :
+            _context(EVP_MD_CTX_create())
+        {
+            if (!_context || EVP_DigestInit_ex(_context, EVP_sha256(), nullptr) != 1) {
+                EVP_MD_CTX_destroy(_context);
+                throw runtime_error("failed to initialize SHA-256 digest.");
+            }
+        }
+
+        ~context()
+        {
+            EVP_MD_CTX_destroy(_context);
+        }
+
+        EVP_MD_CTX* _context;
+    };
+
+    sha256::sha256() :
+        _context(new context())
+    {
+    }
+
+    sha256::~sha256()
+    {
+        // This needs to be defined here since we use an incomplete type in the header
+    }
+
+    void sha256::update(void const* data, size_t size)
+    {
+        EVP_DigestUpdate(_context->_context, data, size);
+    }
+
+    void sha256::update(string const& str)
+    {
+        update(str.data(), str.size());
+    }
+
+    void sha256::update(sha256_digest const& digest)
+    {
+        update(digest.data(), digest.size());
+    }
+
+    void sha256::update(uint64_t value)
+    {
+        // Always use little-endian so the digest is the same on every platform
+        uint8_t bytes[sizeof(value)];
+        for (size_t i = 0; i < sizeof(bytes); ++i) {
+            bytes[i] = static_cast<uint8_t>(value >> (i * 8));
+        }
+        update(bytes, sizeof(bytes));
+    }
+
+    sha256_digest sha256::finish()
+    {
+        sha256_digest digest;
+        unsigned int size = static_cast<unsigned int>(digest.size());
+        EVP_DigestFinal_ex(_context->_context, digest.data(), &size);
+        return digest;
+    }
+
+}}  // namespace facter::util
@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <iterator>
 #include <cstring>
+#include <cstdlib>
+#include <cerrno>
 
 using namespace std;
 
@@ -138,6 +140,22 @@ namespace facter { namespace util {
         return ss.str();
     }
 
+    bool to_integer(string const& str, int64_t& value)
+    {
+        if (str.empty() || str.size() > 20) {
+            return false;
+        }
+
+        errno = 0;
+        char* end = nullptr;
+        long long result = strtoll(str.c_str(), &end, 10);
+        if (errno != 0 || *end != '\0' || to_string(result) != str) {
+            return false;
+        }
+        value = static_cast<int64_t>(result);
+        return true;
+    }
+
     void each_line(string const& s, function<bool(string&)> callback)
     {
         string line;
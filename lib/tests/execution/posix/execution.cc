@@ -3,6 +3,10 @@
 #include <facter/util/string.hpp>
 #include "../../fixtures.hpp"
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
 
 using namespace std;
 using namespace facter::util;
@@ -231,3 +235,265 @@ TEST(execution_posix, each_line_with_lang_environment) {
     ASSERT_EQ(1u, variables.count("LC_ALL"));
     ASSERT_EQ("BAR", variables["LC_ALL"]);
 }
+
+TEST(execution_posix, missing_executable) {
+    // A missing executable results in no output, like any other failing command
+    string output = execute("does_not_exist_executable");
+    ASSERT_EQ("", output);
+
+    try {
+        execute("does_not_exist_executable", option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }));
+        FAIL() << "expected child_exit_exception";
+    } catch (child_exit_exception& ex) {
+        ASSERT_EQ(127, ex.status_code());
+    }
+}
+
+TEST(execution_posix, execute_many) {
+    vector<string> lines;
+    vector<command> commands = {
+        { "cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file3.txt" } },
+        { "ls", { "does_not_exist" } },
+        { "cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file4.txt" } },
+        { "ls", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls" } },
+    };
+    commands[2].callback = [&](string& line) {
+        lines.push_back(line);
+        return true;
+    };
+
+    auto outputs = execute_many(commands);
+    ASSERT_EQ(4u, outputs.size());
+    ASSERT_EQ("file3", outputs[0]);
+    ASSERT_EQ("", outputs[1]);
+    ASSERT_EQ("", outputs[2]);
+    ASSERT_EQ("file1.txt\nfile2.txt\nfile3.txt\nfile4.txt", outputs[3]);
+    ASSERT_EQ(vector<string>({ "line1", "line2", "line3", "line4" }), lines);
+}
+
+TEST(execution_posix, execute_many_failure) {
+    vector<command> commands = {
+        { "cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file3.txt" } },
+        { "ls", { "does_not_exist" }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }) },
+        { "does_not_exist_executable", {}, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }) },
+    };
+
+    // The first failure is reported
+    try {
+        execute_many(commands);
+        FAIL() << "expected child_exit_exception";
+    } catch (child_exit_exception& ex) {
+        ASSERT_NE(127, ex.status_code());
+    }
+}
+
+TEST(execution_posix, execute_many_failures) {
+    vector<command> commands = {
+        { "ls", { "does_not_exist" }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }) },
+        { "cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file3.txt" } },
+        { "ls", { "does_not_exist" }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }) },
+    };
+
+    // Every failure is reported without throwing
+    vector<exception_ptr> failures;
+    auto outputs = execute_many(commands, &failures);
+    ASSERT_EQ(3u, failures.size());
+    ASSERT_THROW(rethrow_exception(failures[0]), child_exit_exception);
+    ASSERT_EQ(nullptr, failures[1]);
+    ASSERT_EQ("file3", outputs[1]);
+    ASSERT_THROW(rethrow_exception(failures[2]), child_exit_exception);
+}
+
+TEST(execution_posix, timeout) {
+    // The whole process group is killed, including children that hold the output pipe open
+    auto start = chrono::steady_clock::now();
+    ASSERT_THROW(execute("sh", { "-c", "sleep 10 & sleep 10" }, { execution_options::defaults }, 1), timeout_exception);
+    ASSERT_LT(chrono::steady_clock::now() - start, chrono::seconds(5));
+
+    // Commands that complete in time are unaffected
+    ASSERT_EQ("file3", execute("cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file3.txt" }, { execution_options::defaults }, 5));
+}
+
+TEST(execution_posix, which) {
+    string path = which("sh");
+    ASSERT_FALSE(path.empty());
+    ASSERT_EQ('/', path[0]);
+    ASSERT_EQ(path, which(path));
+
+    // Missing executables and files that are not executable are not found
+    ASSERT_EQ("", which("does_not_exist_executable"));
+    ASSERT_EQ("", which(LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file1.txt"));
+
+    // Cached results are still correct after clearing the cache
+    clear_which_cache();
+    ASSERT_EQ(path, which("sh"));
+    ASSERT_EQ("", which("does_not_exist_executable"));
+}
+
+TEST(execution_posix, each_line_large_output) {
+    // The output spans many reads, so some lines straddle read boundaries
+    size_t count = 0;
+    bool failed = false;
+    each_line("seq", { "1", "100000" }, [&](string& line) {
+        ++count;
+        failed = failed || line != to_string(count);
+        return true;
+    });
+    ASSERT_FALSE(failed);
+    ASSERT_EQ(100000u, count);
+}
+
+TEST(execution_posix, cache_output) {
+    option_set<execution_options> options = { execution_options::defaults, execution_options::cache_output };
+    clear_output_cache();
+
+    // Without the option, each execution produces new output
+    string first = execute("date", { "+%s%N" });
+    ASSERT_NE(first, execute("date", { "+%s%N" }));
+
+    // With the option, output is reused until the cache is cleared
+    first = execute("date", { "+%s%N" }, options);
+    ASSERT_EQ(first, execute("date", { "+%s%N" }, options));
+    ASSERT_EQ(first, execute_many({ { "date", { "+%s%N" }, options } })[0]);
+    ASSERT_NE(first, execute("date", { "+%s%N" }, { { "TEST_VARIABLE", "TEST_VALUE" } }, options));
+    clear_output_cache();
+    ASSERT_NE(first, execute("date", { "+%s%N" }, options));
+}
+
+TEST(execution_posix, cache_scope) {
+    option_set<execution_options> options = { execution_options::defaults, execution_options::cache_output };
+    execution_cache first_cache;
+    execution_cache second_cache;
+
+    string first;
+    {
+        execution_cache::scope scope(first_cache);
+        first = execute("date", { "+%s%N" }, options);
+    }
+
+    // Output cached in one cache is not seen or cleared through another
+    {
+        execution_cache::scope scope(second_cache);
+        ASSERT_NE(first, execute("date", { "+%s%N" }, options));
+        clear_output_cache();
+    }
+    {
+        execution_cache::scope scope(first_cache);
+        ASSERT_EQ(first, execute("date", { "+%s%N" }, options));
+
+        // Scopes nest and restore the previous cache
+        {
+            execution_cache::scope inner(second_cache);
+            ASSERT_NE(first, execute("date", { "+%s%N" }, options));
+        }
+        ASSERT_EQ(first, execute("date", { "+%s%N" }, options));
+    }
+
+    // Other threads do not see the cache current on this thread
+    {
+        execution_cache::scope scope(first_cache);
+        string other;
+        thread([&]() { other = execute("date", { "+%s%N" }, options); }).join();
+        ASSERT_NE(first, other);
+    }
+}
+
+TEST(execution_posix, capture_stderr) {
+    // Captured error output is drained separately, so a child writing lots of it does not block
+    string output = execute("sh", { "-c", "seq 1 100000 >&2; echo done" }, option_set<execution_options>({ execution_options::defaults, execution_options::capture_stderr }));
+    ASSERT_EQ("done", output);
+
+    // Redirection to stdout takes precedence
+    output = execute("ls", { "does_not_exist" }, option_set<execution_options>({ execution_options::defaults, execution_options::capture_stderr, execution_options::redirect_stderr }));
+    ASSERT_TRUE(ends_with(output, "No such file or directory"));
+}
+
+TEST(execution_posix, spawn_helper) {
+    // Open a descriptor that children would inherit if the helper kept it open
+    int leaked = open(LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file3.txt", O_RDONLY);
+    ASSERT_GE(leaked, 0);
+    ASSERT_TRUE(start_spawn_helper());
+    ASSERT_TRUE(start_spawn_helper());
+
+    // Children are spawned by the helper rather than this process
+    ASSERT_NE(to_string(getpid()), execute("sh", { "-c", "echo $PPID" }));
+
+    // Output, exit status, signals, timeouts, and error output are handled as for children spawned directly
+    ASSERT_EQ("file3", execute("cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file3.txt" }));
+    try {
+        execute("sh", { "-c", "exit 3" }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }));
+        FAIL() << "expected child_exit_exception";
+    } catch (child_exit_exception& ex) {
+        ASSERT_EQ(3, ex.status_code());
+    }
+    ASSERT_THROW(execute("sh", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/selfkill.sh" },  option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_signal })), child_signal_exception);
+    ASSERT_THROW(execute("sh", { "-c", "sleep 10 & sleep 10" }, { execution_options::defaults }, 1), timeout_exception);
+    ASSERT_TRUE(ends_with(execute("ls", { "does_not_exist" }, option_set<execution_options>({ execution_options::defaults, execution_options::redirect_stderr })), "No such file or directory"));
+    ASSERT_EQ("done", execute("sh", { "-c", "echo error >&2; echo done" }, option_set<execution_options>({ execution_options::defaults, execution_options::capture_stderr })));
+    ASSERT_EQ(vector<string>({ "file3", "file1.txt\nfile2.txt\nfile3.txt\nfile4.txt" }), execute_many({
+        { "cat", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls/file3.txt" } },
+        { "ls", { LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/ls" } },
+    }));
+
+    // The environment is passed to the child, and requests too large for the helper are spawned directly
+    ASSERT_EQ("TEST_VALUE", execute("sh", { "-c", "echo $TEST_VARIABLE" }, { { "TEST_VARIABLE", "TEST_VALUE" } }));
+    vector<string> large = { "-c", "echo $PPID" };
+    large.resize(10, string(64 * 1024, 'x'));
+    ASSERT_EQ(to_string(getpid()), execute("sh", large));
+
+    // The child's standard descriptors are its own, and the helper's other descriptors are not inherited
+    ASSERT_EQ("0 1 2", execute("sh", { "-c", "for fd in 0 1 2 3 4 5 6 7 8 9; do [ -e /dev/fd/$fd ] && printf '%s ' $fd; done | sed 's/ $//'" }));
+
+    // Descriptors of this process without close-on-exec are not inherited through the helper
+    string output = execute("sh", { "-c", "[ -e /dev/fd/$0 ] && echo open || echo closed", to_string(leaked) });
+    close(leaked);
+    ASSERT_EQ("closed", output);
+
+    // A child whose helper has exited is not reported as successful, and later children are spawned directly
+    try {
+        execute("sh", { "-c", "kill -9 $PPID" }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }));
+        FAIL() << "expected child_exit_exception";
+    } catch (child_exit_exception& ex) {
+        ASSERT_EQ(127, ex.status_code());
+    }
+    ASSERT_EQ(to_string(getpid()), execute("sh", { "-c", "echo $PPID" }));
+}
+
+TEST(execution_posix, process_limit) {
+    auto limit = get_process_limit();
+    ASSERT_GT(limit, 0u);
+
+    // Each command fails if another is running at the same time, since the lock directory would already exist
+    string lock = LIBFACTER_TESTS_DIRECTORY "/fixtures/execution/process_limit.lock";
+    command locked("sh", { "-c", "mkdir \"$0\" && sleep 0.05 && rmdir \"$0\"", lock }, option_set<execution_options>({ execution_options::defaults, execution_options::throw_on_nonzero_exit }));
+    set_process_limit(1);
+
+    // Batches larger than the limit and launches from other threads wait for a slot rather than deadlocking
+    thread other([&]() {
+        for (int i = 0; i < 3; ++i) {
+            EXPECT_NO_THROW(execute(locked.file, locked.arguments, locked.options));
+        }
+    });
+    EXPECT_NO_THROW(execute_many(vector<command>(4, locked)));
+    other.join();
+
+    // Executing from a line callback does not wait for the slot held by the outer child
+    string nested;
+    each_line("echo", { "outer" }, [&](string& line) {
+        nested = execute("echo", { line });
+        return true;
+    });
+    EXPECT_EQ("outer", nested);
+
+    // A missing executable does not wait for a slot
+    thread holder([]() {
+        execute("sleep", { "1" });
+    });
+    this_thread::sleep_for(chrono::milliseconds(100));
+    auto start = chrono::steady_clock::now();
+    EXPECT_EQ("", execute("does_not_exist_executable"));
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::milliseconds(500));
+    holder.join();
+    set_process_limit(limit);
+    ASSERT_EQ(limit, get_process_limit());
+}
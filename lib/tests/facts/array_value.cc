@@ -1,5 +1,6 @@
 #include <gmock/gmock.h>
 #include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include <rapidjson/document.h>
 #include <yaml-cpp/yaml.h>
@@ -75,6 +76,53 @@ TEST(facter_facts_array_value, each) {
     ASSERT_EQ(3u, count);
 }
 
+TEST(facter_facts_array_value, iterators) {
+    array_value value;
+    value.add(make_value<string_value>("1"));
+    value.add(make_value<integer_value>(2));
+
+    size_t i = 0;
+    for (auto element : value) {
+        ASSERT_EQ(value[i], element);
+        ++i;
+    }
+    ASSERT_EQ(2u, i);
+    ASSERT_EQ(2, value.end() - value.begin());
+}
+
+struct kind_visitor : value_visitor
+{
+    virtual void visit(string_value const& val) { kinds += "s"; }
+    virtual void visit(integer_value const& val) { kinds += "i"; }
+    virtual void visit(boolean_value const& val) { kinds += "b"; }
+    virtual void visit(double_value const& val) { kinds += "d"; }
+    virtual void visit(array_value const& val) { kinds += "a"; }
+    virtual void visit(map_value const& val) { kinds += "m"; }
+
+    string kinds;
+};
+
+TEST(facter_facts_array_value, visitor) {
+    array_value value;
+    value.add(make_value<string_value>("1"));
+    value.add(make_value<integer_value>(2));
+    value.add(make_value<boolean_value>(true));
+    value.add(make_value<double_value>(4.0));
+    value.add(make_value<array_value>());
+    value.add(make_value<map_value>());
+
+    kind_visitor visitor;
+    for (auto element : value) {
+        element->accept(visitor);
+    }
+    ASSERT_EQ("sibdam", visitor.kinds);
+    ASSERT_EQ(value_kind::array, value.kind());
+    ASSERT_EQ(value_kind::dbl, value[3]->kind());
+    ASSERT_NE(nullptr, value.get<integer_value>(1));
+    ASSERT_EQ(nullptr, value.get<string_value>(1));
+    ASSERT_EQ(nullptr, value_cast<map_value>(static_cast<struct value const*>(nullptr)));
+}
+
 TEST(facter_facts_array_value, to_json) {
     auto subarray = make_value<array_value>();
     subarray->add(make_value<string_value>("child"));
@@ -129,3 +177,23 @@ TEST(facter_facts_array_value, yaml_insertion_operator) {
     emitter << value;
     ASSERT_EQ("- \"1\"\n- 2\n-\n  - \"child\"", string(emitter.c_str()));
 }
+
+TEST(facter_facts_array_value, digest) {
+    array_value first;
+    first.add(make_value<string_value>("1"));
+    first.add(make_value<integer_value>(2));
+
+    array_value second;
+    second.add(make_value<string_value>("1"));
+    second.add(make_value<integer_value>(2));
+    ASSERT_EQ(first.digest(), second.digest());
+
+    // Order is significant for arrays
+    array_value third;
+    third.add(make_value<integer_value>(2));
+    third.add(make_value<string_value>("1"));
+    ASSERT_NE(first.digest(), third.digest());
+
+    // An empty array and an empty map are different values
+    ASSERT_NE(array_value().digest(), map_value().digest());
+}
@@ -52,3 +52,13 @@ TEST(facter_facts_external_json_resolver, resolve_json) {
     ASSERT_NE(nullptr, map);
     ASSERT_EQ(2u, map->size());
 }
+
+TEST(facter_facts_external_json_resolver, read) {
+    fact_map facts;
+    facts.clear();
+    ASSERT_THROW(json_resolver::read("does_not_exist", facts), external_fact_exception);
+    json_resolver::read(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/json/facts.json", facts);
+    ASSERT_EQ(6u, facts.size());
+    ASSERT_NE(nullptr, facts.get<string_value>("json_fact1"));
+    ASSERT_EQ("foo", facts.get<string_value>("json_fact1")->value());
+}
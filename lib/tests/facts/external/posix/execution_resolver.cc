@@ -3,6 +3,7 @@
 #include <facter/facts/fact_map.hpp>
 #include <facter/facts/scalar_value.hpp>
 #include "../../../fixtures.hpp"
+#include <chrono>
 
 using namespace std;
 using namespace facter::facts;
@@ -41,3 +42,31 @@ TEST(facter_facts_external_posix_execution_resolver, resolve_execution) {
     ASSERT_EQ("", facts.get<string_value>("exe_fact2")->value());
     ASSERT_EQ(nullptr, facts.get<string_value>("exe_fact3"));
 }
+
+TEST(facter_facts_external_posix_execution_resolver, prepare) {
+    string executable = LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/execution/facts";
+    string failed = LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/execution/failed";
+    string not_executable = LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/execution/not_executable";
+    string sleep = LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/timeout/sleep";
+    execution_resolver resolver(1);
+    fact_map facts;
+
+    // The executables run together, so the timeout applies to all of them at once
+    auto start = chrono::steady_clock::now();
+    resolver.prepare({ executable, failed, not_executable, sleep });
+    ASSERT_LT(chrono::steady_clock::now() - start, chrono::seconds(5));
+
+    // Each file reports its own result
+    ASSERT_TRUE(resolver.resolve(executable, facts));
+    ASSERT_NE(nullptr, facts.get<string_value>("exe_fact1"));
+    ASSERT_EQ("value1", facts.get<string_value>("exe_fact1")->value());
+    ASSERT_THROW(resolver.resolve(failed, facts), external_fact_exception);
+    ASSERT_FALSE(resolver.resolve(not_executable, facts));
+    ASSERT_THROW(resolver.resolve(sleep, facts), external_fact_exception);
+}
+
+TEST(facter_facts_external_posix_execution_resolver, resolve_timeout) {
+    execution_resolver resolver(1);
+    fact_map facts;
+    ASSERT_THROW(resolver.resolve(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/posix/timeout/sleep", facts), external_fact_exception);
+}
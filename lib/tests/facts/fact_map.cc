@@ -6,6 +6,9 @@
 #include <facter/facts/scalar_value.hpp>
 #include "../fixtures.hpp"
 #include <iostream>
+#include <limits>
+#include <locale>
+#include <map>
 
 using namespace std;
 using namespace facter::facts;
@@ -143,6 +146,20 @@ TEST(facter_facts_fact_map, each) {
     ASSERT_FALSE(failed_bar);
 }
 
+TEST(facter_facts_fact_map, iterators) {
+    fact_map facts;
+    facts.clear();
+    facts.add("foo", make_value<string_value>("bar"));
+    facts.add("bar", make_value<integer_value>(5));
+
+    vector<string> names;
+    for (auto const& kvp : facts) {
+        names.push_back(kvp.first);
+        ASSERT_EQ(facts[kvp.first], kvp.second);
+    }
+    ASSERT_EQ(vector<string>({ "bar", "foo" }), names);
+}
+
 TEST(facter_facts_fact_map, write_json) {
     fact_map facts;
     facts.clear();
@@ -182,3 +199,347 @@ TEST(facter_facts_fact_map, insertion_operator_simple) {
     ss << facts;
     ASSERT_EQ("bar", ss.str());
 }
+
+struct dependent_resolver : fact_resolver
+{
+    dependent_resolver() : fact_resolver("dependent", { "baz" }, { "^baz_" })
+    {
+    }
+
+ protected:
+    virtual void resolve_facts(fact_map& facts)
+    {
+        auto foo = facts.get<string_value>("foo");
+        facts.add("baz", make_value<string_value>(foo ? foo->value() : "none"));
+        facts.add("baz_dynamic", make_value<string_value>("dynamic"));
+    }
+};
+
+TEST(facter_facts_fact_map, stream) {
+    fact_map facts;
+    facts.clear();
+    facts.add(make_shared<dependent_resolver>());
+    facts.add(make_shared<multi_resolver>());
+    map<string, string> streamed;
+    facts.stream([&](string const& name, value const* val) {
+        auto string_val = dynamic_cast<string_value const*>(val);
+        ASSERT_NE(nullptr, string_val);
+        ASSERT_EQ(0u, streamed.count(name));
+        streamed.emplace(name, string_val->value());
+    }, {}, false);
+    ASSERT_EQ(4u, streamed.size());
+    ASSERT_EQ("bar", streamed["foo"]);
+    ASSERT_EQ("foo", streamed["bar"]);
+    ASSERT_EQ("bar", streamed["baz"]);
+    ASSERT_EQ("dynamic", streamed["baz_dynamic"]);
+    ASSERT_TRUE(facts.resolved());
+    ASSERT_EQ(0u, facts.size());
+}
+
+struct pattern_resolver : fact_resolver
+{
+    pattern_resolver() : fact_resolver("pattern", {}, { "^pattern_" })
+    {
+    }
+
+ protected:
+    virtual void resolve_facts(fact_map& facts)
+    {
+        facts.add("pattern_fact", make_value<string_value>("pattern"));
+    }
+};
+
+struct pattern_reader_resolver : fact_resolver
+{
+    pattern_reader_resolver() : fact_resolver("reader", { "reader" })
+    {
+    }
+
+ protected:
+    virtual void resolve_facts(fact_map& facts)
+    {
+        auto fact = facts.get<string_value>("pattern_fact");
+        facts.add("reader", make_value<string_value>(fact ? fact->value() : "none"));
+    }
+};
+
+TEST(facter_facts_fact_map, stream_pattern_dependency) {
+    // A fact matched only by a pattern is still available to resolvers that run after it was written
+    fact_map resolved;
+    resolved.clear();
+    resolved.add(make_shared<pattern_resolver>());
+    resolved.add(make_shared<pattern_reader_resolver>());
+    resolved.resolve();
+    map<string, string> expected;
+    resolved.each([&](string const& name, value const* val) {
+        expected.emplace(name, dynamic_cast<string_value const*>(val)->value());
+        return true;
+    });
+
+    fact_map facts;
+    facts.clear();
+    facts.add(make_shared<pattern_resolver>());
+    facts.add(make_shared<pattern_reader_resolver>());
+    map<string, string> streamed;
+    facts.stream([&](string const& name, value const* val) {
+        streamed.emplace(name, dynamic_cast<string_value const*>(val)->value());
+    }, {}, false);
+    ASSERT_EQ("pattern", expected["reader"]);
+    ASSERT_EQ(expected, streamed);
+}
+
+TEST(facter_facts_fact_map, stream_external) {
+    fact_map facts;
+    facts.clear();
+    facts.add(make_shared<multi_resolver>());
+    facts.add("json_fact1", make_value<string_value>("overridden"));
+    map<string, string> streamed;
+    facts.stream([&](string const& name, value const* val) {
+        ostringstream ss;
+        ss << *val;
+        ASSERT_EQ(0u, streamed.count(name));
+        streamed.emplace(name, ss.str());
+    }, {
+        LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/json",
+    });
+    ASSERT_EQ(8u, streamed.size());
+    ASSERT_EQ("bar", streamed["foo"]);
+    ASSERT_EQ("foo", streamed["bar"]);
+    ASSERT_EQ("foo", streamed["json_fact1"]);
+    ASSERT_EQ(0u, facts.size());
+}
+
+TEST(facter_facts_fact_map, write_json_line) {
+    ostringstream ss;
+    auto val = make_value<string_value>("bar");
+    fact_map::write_json_line(ss, "foo", val.get());
+    auto array = make_value<array_value>();
+    array->add(make_value<integer_value>(1));
+    array->add(make_value<boolean_value>(true));
+    fact_map::write_json_line(ss, "array", array.get());
+    ASSERT_EQ("{\"foo\":\"bar\"}\n{\"array\":[1,true]}\n", ss.str());
+}
+
+TEST(facter_facts_fact_map, digest) {
+    fact_map facts;
+    facts.clear();
+    facts.add("foo", make_value<string_value>("bar"));
+    facts.add("integer", make_value<integer_value>(5));
+
+    // The fact map digest is the same as the digest of an equivalent map value
+    map_value equivalent;
+    equivalent.add("integer", make_value<integer_value>(5));
+    equivalent.add("foo", make_value<string_value>("bar"));
+    ASSERT_EQ(equivalent.digest(), facts.digest());
+
+    map<string, facter::util::sha256_digest> digests;
+    facts.each_digest([&](string const& name, facter::util::sha256_digest const& digest) {
+        digests.emplace(name, digest);
+        return true;
+    });
+    ASSERT_EQ(2u, digests.size());
+    ASSERT_EQ(make_value<string_value>("bar")->digest(), digests["foo"]);
+    ASSERT_EQ(make_value<integer_value>(5)->digest(), digests["integer"]);
+
+    auto previous = facts.digest();
+    facts.remove("foo");
+    facts.add("foo", make_value<string_value>("baz"));
+    ASSERT_NE(previous, facts.digest());
+}
+
+TEST(facter_facts_fact_map, diff) {
+    fact_map previous;
+    previous.clear();
+    previous.add("removed", make_value<string_value>("foo"));
+    previous.add("same", make_value<integer_value>(1));
+    auto previous_map = make_value<map_value>();
+    previous_map->add("a", make_value<string_value>("1"));
+    previous_map->add("b", make_value<string_value>("2"));
+    previous.add("map", move(previous_map));
+
+    fact_map current;
+    current.clear();
+    current.add("added", make_value<boolean_value>(true));
+    current.add("same", make_value<integer_value>(1));
+    auto current_map = make_value<map_value>();
+    current_map->add("b", make_value<string_value>("2"));
+    current_map->add("a", make_value<string_value>("changed"));
+    current.add("map", move(current_map));
+
+    map<string, pair<value const*, value const*>> changes;
+    current.diff(previous, [&](string const& name, value const* previous_value, value const* current_value) {
+        changes.emplace(name, make_pair(previous_value, current_value));
+        return true;
+    });
+    ASSERT_EQ(3u, changes.size());
+    ASSERT_EQ(nullptr, changes["added"].first);
+    ASSERT_EQ(current["added"], changes["added"].second);
+    ASSERT_EQ(previous["removed"], changes["removed"].first);
+    ASSERT_EQ(nullptr, changes["removed"].second);
+    ASSERT_EQ(previous["map"], changes["map"].first);
+    ASSERT_EQ(current["map"], changes["map"].second);
+
+    ostringstream json;
+    current.write_json_diff(json, previous);
+    ASSERT_EQ("{\n  \"added\": true,\n  \"map\": {\n    \"a\": \"changed\",\n    \"b\": \"2\"\n  },\n  \"removed\": null\n}", json.str());
+
+    ostringstream yaml;
+    current.write_yaml_diff(yaml, previous);
+    ASSERT_EQ("added: true\nmap:\n  a: \"changed\"\n  b: \"2\"\nremoved: ~", yaml.str());
+
+    // Nothing differs from itself
+    bool differs = false;
+    current.diff(current, [&](string const&, value const*, value const*) {
+        differs = true;
+        return true;
+    });
+    ASSERT_FALSE(differs);
+}
+
+TEST(facter_facts_fact_map, write_json_compact) {
+    fact_map facts;
+    facts.clear();
+    facts.add("string", make_value<string_value>("bar"));
+    facts.add("integer", make_value<integer_value>(5));
+    facts.add("double", make_value<double_value>(0.1));
+    facts.add("whole", make_value<double_value>(5.0));
+    facts.add("precise", make_value<double_value>(1.0 / 3.0));
+    auto array = make_value<array_value>();
+    array->add(make_value<boolean_value>(false));
+    facts.add("array", move(array));
+
+    ostringstream ss;
+    facts.write_json_compact(ss);
+    ASSERT_EQ("{\"array\":[false],\"double\":0.1,\"integer\":5,\"precise\":0.33333333333333331,\"string\":\"bar\",\"whole\":5.0}", ss.str());
+
+    ostringstream subset;
+    facts.write_json_compact(subset, { "string", "integer", "does_not_exist" });
+    ASSERT_EQ("{\"integer\":5,\"string\":\"bar\"}", subset.str());
+}
+
+struct comma_numpunct : numpunct<char>
+{
+ protected:
+    virtual char do_decimal_point() const
+    {
+        return ',';
+    }
+};
+
+TEST(facter_facts_fact_map, write_json_compact_locale) {
+    fact_map facts;
+    facts.clear();
+    facts.add("double", make_value<double_value>(0.5));
+    facts.add("infinity", make_value<double_value>(numeric_limits<double>::infinity()));
+    facts.add("nan", make_value<double_value>(numeric_limits<double>::quiet_NaN()));
+
+    // The output does not depend on the global locale
+    auto previous = locale::global(locale(locale::classic(), new comma_numpunct()));
+    ostringstream ss;
+    facts.write_json_compact(ss);
+    locale::global(previous);
+
+    // Non-finite values are written as null
+    ASSERT_EQ("{\"double\":0.5,\"infinity\":null,\"nan\":null}", ss.str());
+}
+
+TEST(facter_facts_fact_map, refresh) {
+    fact_map facts;
+    facts.clear();
+    facts.add("kernel", make_value<string_value>("stale"));
+    facts.add("kernelrelease", make_value<string_value>("stale"));
+    facts.add("ipaddress_doesnotexist0", make_value<string_value>("127.0.0.2"));
+    facts.add("custom", make_value<string_value>("unchanged"));
+
+    facts.refresh({ "kernel", "ipaddress", "does_not_exist" });
+
+    // Every fact of the refreshed resolvers is replaced
+    auto kernel = facts.get<string_value>("kernel");
+    ASSERT_NE(nullptr, kernel);
+    ASSERT_NE("stale", kernel->value());
+    auto release = facts.get<string_value>("kernelrelease");
+    ASSERT_NE(nullptr, release);
+    ASSERT_NE("stale", release->value());
+
+    // Facts that no longer resolve are removed
+    ASSERT_EQ(nullptr, facts["ipaddress_doesnotexist0"]);
+
+    // Other facts are left alone
+    auto custom = facts.get<string_value>("custom");
+    ASSERT_NE(nullptr, custom);
+    ASSERT_EQ("unchanged", custom->value());
+    ASSERT_EQ(nullptr, facts["does_not_exist"]);
+}
+
+struct counting_resolver : fact_resolver
+{
+    counting_resolver() : fact_resolver("counting", { "foo" }), count(0)
+    {
+    }
+
+    int count;
+
+ protected:
+    virtual void resolve_facts(fact_map& facts)
+    {
+        ++count;
+        facts.add("foo", make_value<string_value>("bar" + to_string(count)));
+    }
+};
+
+TEST(facter_facts_fact_map, refresh_dependency) {
+    auto counting = make_shared<counting_resolver>();
+    fact_map facts;
+    facts.clear();
+    facts.add(counting);
+    facts.add(make_shared<dependent_resolver>());
+    facts.resolve();
+    ASSERT_EQ(1, counting->count);
+    ASSERT_EQ("bar1", facts.get<string_value>("baz")->value());
+
+    // A dependency that is not being refreshed is taken from the map
+    facts.refresh({ "baz" });
+    ASSERT_EQ(1, counting->count);
+    ASSERT_EQ("bar1", facts.get<string_value>("foo")->value());
+    ASSERT_EQ("bar1", facts.get<string_value>("baz")->value());
+
+    // A dependency that is also being refreshed is resolved once and its new value is used
+    facts.refresh({ "baz", "foo" });
+    ASSERT_EQ(2, counting->count);
+    ASSERT_EQ("bar2", facts.get<string_value>("foo")->value());
+    ASSERT_EQ("bar2", facts.get<string_value>("baz")->value());
+}
+
+TEST(facter_facts_fact_map, resolve_concurrently) {
+    fact_map facts;
+    facts.resolve_concurrently({ "kernel", "operatingsystem", "hostname", "uptime", "does_not_exist" });
+    ASSERT_NE(nullptr, facts.get<string_value>("kernel", false));
+    ASSERT_NE(nullptr, facts.get<string_value>("kernelrelease", false));
+    ASSERT_NE(nullptr, facts.get<string_value>("operatingsystem", false));
+    ASSERT_NE(nullptr, facts.get<string_value>("hostname", false));
+    ASSERT_NE(nullptr, facts.get<string_value>("uptime", false));
+    ASSERT_EQ(nullptr, facts.get<string_value>("does_not_exist", false));
+
+    // The values match resolving the facts one at a time
+    fact_map expected;
+    ASSERT_EQ(expected.get<string_value>("kernel")->value(), facts.get<string_value>("kernel", false)->value());
+    ASSERT_EQ(expected.get<string_value>("operatingsystem")->value(), facts.get<string_value>("operatingsystem", false)->value());
+}
+
+TEST(facter_facts_fact_map, legacy_strings) {
+    fact_map facts;
+    facts.clear();
+    ASSERT_FALSE(facts.legacy_strings());
+    facts.add("processorcount", make_value<integer_value>(4));
+    ASSERT_NE(nullptr, facts.get<integer_value>("processorcount"));
+
+    facts.legacy_strings(true);
+    facts.add("processorcount", make_value<integer_value>(4));
+    facts.add("mtu_eth0", make_value<integer_value>(1500));
+    facts.add("lsbminordistrelease", make_value<string_value>("04"));
+    facts.add("uptime_seconds", make_value<integer_value>(10));
+    ASSERT_EQ("4", facts.get<string_value>("processorcount")->value());
+    ASSERT_EQ("1500", facts.get<string_value>("mtu_eth0")->value());
+    ASSERT_EQ("04", facts.get<string_value>("lsbminordistrelease")->value());
+    ASSERT_NE(nullptr, facts.get<integer_value>("uptime_seconds"));
+}
@@ -5,6 +5,7 @@
 #include <rapidjson/document.h>
 #include <yaml-cpp/yaml.h>
 #include <sstream>
+#include <thread>
 
 using namespace std;
 using namespace facter::facts;
@@ -62,6 +63,28 @@ TEST(facter_facts_map_value, map_constructor) {
     ASSERT_EQ("bar", str->value());
 }
 
+TEST(facter_facts_map_value, concurrent_reads) {
+    // Elements are sorted as they are added, so a map added to out of order can be read from several threads at once
+    map_value value;
+    for (int i = 100; i > 0; --i) {
+        value.add(to_string(i), make_value<integer_value>(i));
+    }
+    vector<thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            for (int j = 1; j <= 100; ++j) {
+                auto element = value.get<integer_value>(to_string(j));
+                EXPECT_NE(nullptr, element);
+                EXPECT_EQ(j, element ? element->value() : 0);
+            }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQ(100u, value.size());
+}
+
 TEST(facter_facts_map_value, each) {
     map_value value;
     value.add("fact1", make_value<string_value>("1"));
@@ -89,6 +112,50 @@ TEST(facter_facts_map_value, each) {
     ASSERT_EQ(3u, count);
 }
 
+TEST(facter_facts_map_value, unordered_add) {
+    map_value value;
+    value.reserve(4);
+    value.add("charlie", make_value<string_value>("3"));
+    value.add("alpha", make_value<string_value>("1"));
+    value.add("bravo", make_value<string_value>("2"));
+    value.add("alpha", make_value<string_value>("duplicate"));
+    ASSERT_EQ(3u, value.size());
+
+    // The first value added for a name is kept
+    ASSERT_EQ("1", value.get<string_value>("alpha")->value());
+    ASSERT_EQ("2", value.get<string_value>("bravo")->value());
+    ASSERT_EQ("3", value.get<string_value>("charlie")->value());
+    ASSERT_EQ(nullptr, value["delta"]);
+    ASSERT_EQ(nullptr, value[""]);
+
+    // Elements added after reading are also found
+    value.add("aardvark", make_value<string_value>("0"));
+    ASSERT_EQ("0", value.get<string_value>("aardvark")->value());
+
+    vector<string> names;
+    for (auto const& kvp : value) {
+        names.push_back(kvp.first);
+    }
+    ASSERT_EQ(vector<string>({ "aardvark", "alpha", "bravo", "charlie" }), names);
+}
+
+TEST(facter_facts_map_value, iterators) {
+    map_value value;
+    value.add("fact2", make_value<string_value>("2"));
+    value.add("fact1", make_value<string_value>("1"));
+
+    vector<string> names;
+    for (auto const& kvp : value) {
+        names.push_back(kvp.first);
+        ASSERT_EQ(value[kvp.first], kvp.second);
+    }
+    ASSERT_EQ(vector<string>({ "fact1", "fact2" }), names);
+    ASSERT_EQ("fact1", value.begin()->first);
+
+    map_value empty;
+    ASSERT_TRUE(empty.begin() == empty.end());
+}
+
 TEST(facter_facts_map_value, to_json) {
     map_value value;
     value.add("string", make_value<string_value>("hello"));
@@ -163,3 +230,30 @@ TEST(facter_facts_map_value, yaml_insertion_operator) {
     emitter << value;
     ASSERT_EQ("array:\n  - \"1\"\n  - 2\ninteger: 5\nmap:\n  foo: \"bar\"\nstring: \"hello\"", string(emitter.c_str()));
 }
+
+TEST(facter_facts_map_value, digest) {
+    map_value first;
+    first.add("string", make_value<string_value>("hello"));
+    first.add("integer", make_value<integer_value>(5));
+
+    // Insertion order should not change the digest
+    map_value second;
+    second.add("integer", make_value<integer_value>(5));
+    second.add("string", make_value<string_value>("hello"));
+    ASSERT_EQ(first.digest(), second.digest());
+
+    // Changing the type of a value should change the digest
+    map_value third;
+    third.add("integer", make_value<string_value>("5"));
+    third.add("string", make_value<string_value>("hello"));
+    ASSERT_NE(first.digest(), third.digest());
+
+    // Moving a key's characters into the value should change the digest
+    map_value fourth;
+    fourth.add("ab", make_value<string_value>("c"));
+    map_value fifth;
+    fifth.add("a", make_value<string_value>("bc"));
+    ASSERT_NE(fourth.digest(), fifth.digest());
+
+    ASSERT_NE(map_value().digest(), first.digest());
+}
@@ -0,0 +1,139 @@
+#include <gmock/gmock.h>
+#include <facter/facts/snapshot.hpp>
+#include <facter/facts/fact_map.hpp>
+#include <facter/facts/array_value.hpp>
+#include <facter/facts/map_value.hpp>
+#include <facter/facts/scalar_value.hpp>
+#include <facter/util/file.hpp>
+#include "../fixtures.hpp"
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace facter::facts;
+using namespace facter::util;
+
+struct temp_snapshot_path
+{
+    temp_snapshot_path() :
+        path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string())
+    {
+    }
+
+    ~temp_snapshot_path()
+    {
+        boost::filesystem::remove(path);
+    }
+
+    string path;
+};
+
+static void add_test_facts(fact_map& facts)
+{
+    facts.clear();
+    facts.add("string", make_value<string_value>("hello"));
+    facts.add("integer", make_value<integer_value>(-5));
+    facts.add("boolean", make_value<boolean_value>(true));
+    facts.add("double", make_value<double_value>(5.1));
+
+    auto array = make_value<array_value>();
+    array->add(make_value<string_value>("hello"));
+    array->add(make_value<integer_value>(2));
+    facts.add("array", move(array));
+
+    auto child = make_value<map_value>();
+    child->add("foo", make_value<string_value>("bar"));
+    auto map = make_value<map_value>();
+    map->add("child", move(child));
+    map->add("empty", make_value<array_value>());
+    facts.add("map", move(map));
+}
+
+TEST(facter_facts_snapshot, nonexistent_snapshot) {
+    ASSERT_THROW(snapshot("does_not_exist"), snapshot_exception);
+}
+
+TEST(facter_facts_snapshot, invalid_snapshot) {
+    ASSERT_THROW(snapshot(LIBFACTER_TESTS_DIRECTORY "/fixtures/facts/external/json/facts.json"), snapshot_exception);
+}
+
+TEST(facter_facts_snapshot, truncated_snapshot) {
+    fact_map facts;
+    add_test_facts(facts);
+    temp_snapshot_path temp;
+    snapshot::write(temp.path, facts);
+
+    string contents = file::read(temp.path);
+    ASSERT_TRUE(file::atomic_write(temp.path, [&](ostream& stream) { stream << contents.substr(0, contents.size() - 1); }));
+    ASSERT_THROW(snapshot(temp.path), snapshot_exception);
+}
+
+TEST(facter_facts_snapshot, roundtrip) {
+    fact_map facts;
+    add_test_facts(facts);
+    temp_snapshot_path temp;
+    snapshot::write(temp.path, facts);
+
+    snapshot snap(temp.path);
+    ASSERT_EQ(6u, snap.size());
+    ASSERT_EQ(nullptr, snap.get("does_not_exist"));
+    ASSERT_EQ(nullptr, snap.get(""));
+    ASSERT_EQ(nullptr, snap.get("strings"));
+
+    // Every fact can be found by name and has the same digest as the original
+    facts.each([&](string const& name, value const* val) {
+        auto found = snap.get(name);
+        EXPECT_NE(nullptr, found);
+        if (found) {
+            EXPECT_EQ(val->digest(), found->digest());
+        }
+        return true;
+    });
+
+    auto str = snap.get("string");
+    ASSERT_NE(nullptr, dynamic_cast<string_value const*>(str.get()));
+    ASSERT_EQ("hello", dynamic_cast<string_value const*>(str.get())->value());
+    auto integer = snap.get("integer");
+    ASSERT_NE(nullptr, dynamic_cast<integer_value const*>(integer.get()));
+    ASSERT_EQ(-5, dynamic_cast<integer_value const*>(integer.get())->value());
+
+    fact_map loaded;
+    loaded.clear();
+    snap.populate(loaded);
+    ASSERT_EQ(facts.digest(), loaded.digest());
+
+    fact_map subset;
+    subset.clear();
+    snap.populate(subset, { "double", "map", "does_not_exist" });
+    ASSERT_EQ(2u, subset.size());
+    ASSERT_NE(nullptr, subset.get<double_value>("double", false));
+    ASSERT_DOUBLE_EQ(5.1, subset.get<double_value>("double", false)->value());
+    ASSERT_NE(nullptr, subset.get<map_value>("map", false));
+}
+
+TEST(facter_facts_snapshot, empty) {
+    fact_map facts;
+    facts.clear();
+    temp_snapshot_path temp;
+    snapshot::write(temp.path, facts);
+
+    snapshot snap(temp.path);
+    ASSERT_EQ(0u, snap.size());
+    ASSERT_EQ(nullptr, snap.get("foo"));
+}
+
+TEST(facter_facts_snapshot, replace) {
+    fact_map facts;
+    add_test_facts(facts);
+    temp_snapshot_path temp;
+    snapshot::write(temp.path, facts);
+
+    // An existing mapping is unaffected when the snapshot is replaced
+    snapshot original(temp.path);
+    facts.remove("string");
+    facts.add("string", make_value<string_value>("world"));
+    snapshot::write(temp.path, facts);
+
+    snapshot updated(temp.path);
+    ASSERT_EQ("hello", dynamic_cast<string_value const*>(original.get("string").get())->value());
+    ASSERT_EQ("world", dynamic_cast<string_value const*>(updated.get("string").get())->value());
+}
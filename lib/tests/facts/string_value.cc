@@ -23,6 +23,43 @@ TEST(facter_facts_string_value, copy_constructor) {
     ASSERT_EQ("hello world", value.value());
 }
 
+TEST(facter_facts_string_value, shared_constructor) {
+    auto shared = make_shared<string const>("hello world");
+    string_value first(shared);
+    string_value second(first.shared());
+    ASSERT_EQ("hello world", first.value());
+    ASSERT_EQ(&first.value(), &second.value());
+    ASSERT_EQ(3, shared.use_count());
+    ASSERT_EQ(first.digest(), second.digest());
+
+    string_value empty(shared_ptr<string const>(nullptr));
+    ASSERT_EQ("", empty.value());
+}
+
+TEST(facter_facts_string_value, moved_from) {
+    // A moved-from value is an empty string rather than a null string
+    string_value value("hello world");
+    string_value moved(move(value));
+    ASSERT_EQ("hello world", moved.value());
+    ASSERT_EQ("", value.value());
+
+    string_value assigned("goodbye");
+    assigned = move(moved);
+    ASSERT_EQ("hello world", assigned.value());
+    ASSERT_EQ("", moved.value());
+
+    rapidjson::Value json_value;
+    MemoryPoolAllocator<> allocator;
+    moved.to_json(allocator, json_value);
+    ASSERT_TRUE(json_value.IsString());
+    ASSERT_EQ("", string(json_value.GetString()));
+
+    ostringstream stream;
+    stream << moved;
+    ASSERT_EQ("", stream.str());
+    ASSERT_EQ(string_value("").digest(), moved.digest());
+}
+
 TEST(facter_facts_string_value, to_json) {
     string_value value("hello world");
 
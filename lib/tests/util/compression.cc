@@ -0,0 +1,89 @@
+#include <gmock/gmock.h>
+#include <facter/util/compression.hpp>
+#include <zlib.h>
+#include <sstream>
+
+using namespace std;
+using namespace facter::util;
+
+static string inflate_gzip(string const& data)
+{
+    z_stream stream = {};
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        return {};
+    }
+
+    string result;
+    char buffer[1024];
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    int status;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        status = inflate(&stream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END) {
+            break;
+        }
+        result.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (status != Z_STREAM_END);
+
+    inflateEnd(&stream);
+    return status == Z_STREAM_END ? result : string();
+}
+
+TEST(facter_util_compression, gzip_empty) {
+    ostringstream output;
+    gzip_ostream stream(output);
+    stream.finish();
+    ASSERT_FALSE(output.str().empty());
+    ASSERT_EQ("", inflate_gzip(output.str()));
+}
+
+TEST(facter_util_compression, gzip_roundtrip) {
+    ostringstream output;
+    ostringstream expected;
+    {
+        gzip_ostream stream(output);
+        for (int i = 0; i < 10000; ++i) {
+            stream << "fact_" << i << " => " << i * 7 << '\n';
+            expected << "fact_" << i << " => " << i * 7 << '\n';
+        }
+        stream.finish();
+    }
+    ASSERT_LT(output.str().size(), expected.str().size());
+    ASSERT_EQ(expected.str(), inflate_gzip(output.str()));
+}
+
+TEST(facter_util_compression, gzip_finish_on_destruction) {
+    ostringstream output;
+    {
+        gzip_ostream stream(output);
+        stream << "hello world";
+    }
+    ASSERT_EQ("hello world", inflate_gzip(output.str()));
+}
+
+TEST(facter_util_compression, gzip_flush) {
+    ostringstream output;
+    gzip_ostream stream(output);
+    stream << "hello" << flush;
+
+    // A flushed stream can be partially decompressed before it is finished
+    z_stream zstream = {};
+    ASSERT_EQ(Z_OK, inflateInit2(&zstream, 15 + 16));
+    string data = output.str();
+    char buffer[64];
+    zstream.next_in = reinterpret_cast<Bytef*>(&data[0]);
+    zstream.avail_in = static_cast<uInt>(data.size());
+    zstream.next_out = reinterpret_cast<Bytef*>(buffer);
+    zstream.avail_out = sizeof(buffer);
+    ASSERT_EQ(Z_OK, inflate(&zstream, Z_SYNC_FLUSH));
+    ASSERT_EQ("hello", string(buffer, sizeof(buffer) - zstream.avail_out));
+    inflateEnd(&zstream);
+
+    stream << " world";
+    stream.finish();
+    ASSERT_EQ("hello world", inflate_gzip(output.str()));
+}
@@ -2,6 +2,7 @@
 #include <facter/util/file.hpp>
 #include <facter/util/string.hpp>
 #include "../fixtures.hpp"
+#include <boost/filesystem.hpp>
 
 using namespace std;
 using namespace facter::util;
@@ -98,3 +99,15 @@ TEST(facter_util_file, read_first_line) {
     ASSERT_TRUE(file::read_first_line(fixture_file_path, data));
     ASSERT_EQ(lines[0], data);
 }
+
+TEST(facter_util_file, atomic_write) {
+    auto path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+
+    ASSERT_TRUE(file::atomic_write(path, [](ostream& stream) { stream << "first"; }));
+    ASSERT_EQ("first", file::read(path));
+    ASSERT_TRUE(file::atomic_write(path, [](ostream& stream) { stream << "second"; }));
+    ASSERT_EQ("second", file::read(path));
+    boost::filesystem::remove(path);
+
+    ASSERT_FALSE(file::atomic_write("/does/not/exist/file", [](ostream& stream) { stream << "data"; }));
+}
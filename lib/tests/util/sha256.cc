@@ -0,0 +1,29 @@
+#include <gmock/gmock.h>
+#include <facter/util/sha256.hpp>
+#include <facter/util/string.hpp>
+
+using namespace std;
+using namespace facter::util;
+
+TEST(facter_util_sha256, empty) {
+    sha256 hash;
+    auto digest = hash.finish();
+    ASSERT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", to_hex(digest.data(), digest.size()));
+}
+
+TEST(facter_util_sha256, incremental) {
+    sha256 hash;
+    hash.update("a", 1);
+    hash.update(string("bc"));
+    auto digest = hash.finish();
+    ASSERT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", to_hex(digest.data(), digest.size()));
+}
+
+TEST(facter_util_sha256, integer) {
+    sha256 first;
+    first.update(static_cast<uint64_t>(0x0102030405060708ull));
+    sha256 second;
+    uint8_t bytes[] = { 8, 7, 6, 5, 4, 3, 2, 1 };
+    second.update(bytes, sizeof(bytes));
+    ASSERT_EQ(first.finish(), second.finish());
+}